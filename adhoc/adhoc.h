@@ -11,14 +11,49 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 
 #include <vector>
 #include <string>
+#include <tr1/memory>
 
 #include "../stringTable.h"
 #include "../datas.h"
+#include "charClasses.h"
 
 //Normalize a string
 std::vector<unsigned int> adhocStringNormalize(const std::string &str, StringTable &stringTable);
 
+//Scratch space for adhocStringNormalize, reused from call to call so that normalizing needs no
+//allocations of its own once it has grown big enough
+struct NormalizeBuffer
+{
+    ClassifiedText text;
+    std::string word;
+};//NormalizeBuffer
+
+//Same, for the text in [begin, end). The word ids are appended to words.
+void adhocStringNormalize(const char *begin, const char *end, StringTable &stringTable, std::vector<unsigned int> &words, NormalizeBuffer &buffer);
+
+//The normalized fields the adhoc matcher reads. Only these need normalizing when the files are read in.
+FieldSet adhocMatchingFields();
+
+//The products queued up for the matching threads
+class ProductStack;
+
+//Set up the product side of the matching. Only the products need to be in datas, so this
+//can run while the listings are still being read in.
+std::tr1::shared_ptr<ProductStack> prepareAdhocProducts(Datas &datas);
+
+//How doAdhocMatching splits the work up between its threads. Both give the same results.
+enum AdhocMatchingMode
+{
+    ProductParallelMatching,    //Threads take products off a shared stack and score each against all the listings
+    ListingPartitionedMatching  //Each thread scores every product against its own range of the listings
+};//AdhocMatchingMode
+
 //Determine the product->listings matchings. Spawn off N threads and go from there.
-void doAdhocMatching(Datas &datas, unsigned int numThreads);
+//Only listings from firstListing on are scored; the ones before it keep the best match they already have.
+void doAdhocMatching(Datas &datas, unsigned int numThreads, unsigned int firstListing = 0, AdhocMatchingMode mode = ProductParallelMatching);
+
+//Same, with the product side already set up by prepareAdhocProducts
+void doAdhocMatching(Datas &datas, std::tr1::shared_ptr<ProductStack> productStack, unsigned int numThreads, unsigned int firstListing = 0,
+                     AdhocMatchingMode mode = ProductParallelMatching);
 
 #endif
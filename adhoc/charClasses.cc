@@ -0,0 +1,142 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#include "charClasses.h"
+#include <string.h>
+#include <ctype.h>
+
+#if !defined(ADHOC_NO_SIMD_NORMALIZE) && (defined(__x86_64__) || defined(__SSE2__))
+#define ADHOC_SIMD_NORMALIZE 1
+#include <emmintrin.h>
+#endif
+
+bool isPunctuation(char c)
+{
+    if (ispunct(c) != 0) {
+        return true;
+    } else {
+        switch (c) {
+            case '(':
+            case ')':
+                return true;
+
+            default:
+                ;
+                //Nothing
+        }//switch
+
+        return false;
+    }//if
+}//isPunctuation
+
+namespace
+{
+
+//Size the buffers of text for length characters. The lowered text is padded out to a whole
+//number of 16 character blocks and the masks to a whole number of 64 character ones.
+void prepareText(ClassifiedText &text, size_t length)
+{
+    size_t numMasks = (length + 63) / 64;
+
+    text.length = length;
+    text.lowered.resize((length + 15) & ~size_t(15));
+    text.spaceMasks.assign(numMasks, 0);
+    text.dashMasks.assign(numMasks, 0);
+    text.punctuationMasks.assign(numMasks, 0);
+}//prepareText
+
+//Classify the characters in [begin, end), the first of which is character pos of text, one at a time
+void classifyCharacters(const char *begin, const char *end, size_t pos, ClassifiedText &text)
+{
+    for (const char *c = begin; c != end; ++c, ++pos) {
+        uint64_t bit = uint64_t(1) << (pos % 64);
+
+        text.lowered[pos] = static_cast<char>(tolower(static_cast<unsigned char>(*c)));
+
+        if (isspace(static_cast<unsigned char>(*c)) != 0) {
+            text.spaceMasks[pos / 64] |= bit;
+        }//if
+        if ('-' == *c) {
+            text.dashMasks[pos / 64] |= bit;
+        }//if
+        if (isPunctuation(*c) == true) {
+            text.punctuationMasks[pos / 64] |= bit;
+        }//if
+    }//for
+}//classifyCharacters
+
+#ifdef ADHOC_SIMD_NORMALIZE
+
+//Bytes of chunk with low < byte < high, as signed bytes. Non-ASCII bytes are negative, so never in a range.
+inline __m128i inRange(__m128i chunk, char low, char high)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(low)), _mm_cmpgt_epi8(_mm_set1_epi8(high), chunk));
+}//inRange
+
+//Classify the 16 ASCII characters of chunk, which are characters pos to pos + 15 of text
+inline void classifyChunk(__m128i chunk, size_t pos, ClassifiedText &text)
+{
+    //isspace: \t \n \v \f \r and ' '
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), inRange(chunk, '\t' - 1, '\r' + 1));
+    __m128i dash = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('-'));
+
+    //ispunct: everything printable that isn't a letter, digit or space
+    __m128i punctuation = _mm_or_si128(_mm_or_si128(inRange(chunk, ' ', '0'), inRange(chunk, '9', 'A')),
+                                       _mm_or_si128(inRange(chunk, 'Z', 'a'), inRange(chunk, 'z', 127)));
+
+    __m128i upper = inRange(chunk, 'A' - 1, 'Z' + 1);
+    __m128i lowered = _mm_or_si128(chunk, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&text.lowered[pos]), lowered);
+
+    unsigned int shift = pos % 64;
+    text.spaceMasks[pos / 64] |= uint64_t(_mm_movemask_epi8(space)) << shift;
+    text.dashMasks[pos / 64] |= uint64_t(_mm_movemask_epi8(dash)) << shift;
+    text.punctuationMasks[pos / 64] |= uint64_t(_mm_movemask_epi8(punctuation)) << shift;
+}//classifyChunk
+
+#endif
+
+}//anonymous namespace
+
+//Fill in text for [begin, end), using SIMD where it can
+void classifyText(const char *begin, const char *end, ClassifiedText &text)
+{
+#ifdef ADHOC_SIMD_NORMALIZE
+    size_t length = end - begin;
+    prepareText(text, length);
+
+    for (size_t pos = 0; pos < length; pos += 16) {
+        __m128i chunk;
+        if (length - pos >= 16) {
+            chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + pos));
+        } else {
+            //Zeros are in no class, and end up in the padding past length
+            char lastChunk[16] = {0};
+            memcpy(lastChunk, begin + pos, length - pos);
+            chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lastChunk));
+        }//if
+
+        if (_mm_movemask_epi8(chunk) != 0) {
+            const char *chunkEnd = (length - pos >= 16) ? begin + pos + 16 : end;
+            classifyCharacters(begin + pos, chunkEnd, pos, text);
+        } else {
+            classifyChunk(chunk, pos, text);
+        }//if
+    }//for
+#else
+    classifyTextScalar(begin, end, text);
+#endif
+}//classifyText
+
+//Same, going through the ctype calls one character at a time
+void classifyTextScalar(const char *begin, const char *end, ClassifiedText &text)
+{
+    prepareText(text, end - begin);
+    classifyCharacters(begin, end, 0, text);
+}//classifyTextScalar
+
@@ -0,0 +1,111 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __CHARCLASSES_H
+#define __CHARCLASSES_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//Normalizing only cares about a handful of character classes: whitespace splits words, dashes get
+//dropped and punctuation gets trimmed off the ends of words. A ClassifiedText holds those classes for
+//a piece of text as bit masks, 64 characters to a mask (bit n of mask m is character 64*m + n),
+//along with the lower cased text. Words can then be found a mask at a time instead of a character at
+//a time, and there are no ctype calls left in the word loop.
+//
+//Classification is done 16 characters at a time with SSE2 where there is SSE2. Blocks holding
+//non-ASCII characters go through the ctype calls instead, so the classes are always the same as
+//isspace/ispunct/tolower give. Define ADHOC_NO_SIMD_NORMALIZE to always use the ctype calls.
+class ClassifiedText
+{
+public:
+    std::string lowered;                    //Padded out past length, only [0, length) means anything
+    std::vector<uint64_t> spaceMasks;
+    std::vector<uint64_t> dashMasks;
+    std::vector<uint64_t> punctuationMasks; //Dashes are punctuation too
+    size_t length;
+
+    ClassifiedText() : length(0) {}
+
+    //First character in [pos, end) which is (or with isSet false, isn't) in masks, or end
+    size_t findNext(const std::vector<uint64_t> &masks, size_t pos, size_t end, bool isSet) const
+    {
+        while (pos < end) {
+            size_t blockBegin = pos & ~size_t(63);
+            uint64_t bits = (true == isSet) ? masks[pos / 64] : ~masks[pos / 64];
+            bits &= ~uint64_t(0) << (pos - blockBegin);
+
+            if (bits != 0) {
+                size_t found = blockBegin + __builtin_ctzll(bits);
+                return (found < end) ? found : end;
+            }//if
+
+            pos = blockBegin + 64;
+        }//while
+
+        return end;
+    }//findNext
+
+    //Last character in [begin, end) which isn't in masks, or std::string::npos
+    size_t findLastNotSet(const std::vector<uint64_t> &masks, size_t begin, size_t end) const
+    {
+        size_t pos = end;
+        while (pos > begin) {
+            size_t blockBegin = (pos - 1) & ~size_t(63);
+            uint64_t bits = ~masks[(pos - 1) / 64];
+
+            unsigned int top = (pos - 1) - blockBegin;
+            if (top != 63) {
+                bits &= (uint64_t(2) << top) - 1;
+            }//if
+            if (begin > blockBegin) {
+                bits &= ~uint64_t(0) << (begin - blockBegin);
+            }//if
+
+            if (bits != 0) {
+                return blockBegin + 63 - __builtin_clzll(bits);
+            }//if
+
+            pos = blockBegin;
+        }//while
+
+        return std::string::npos;
+    }//findLastNotSet
+
+    //How many characters in [begin, end) are in masks
+    size_t count(const std::vector<uint64_t> &masks, size_t begin, size_t end) const
+    {
+        size_t total = 0;
+        size_t pos = begin;
+        while (pos < end) {
+            size_t blockBegin = pos & ~size_t(63);
+            uint64_t bits = masks[pos / 64] & (~uint64_t(0) << (pos - blockBegin));
+            if (end - blockBegin < 64) {
+                bits &= (uint64_t(1) << (end - blockBegin)) - 1;
+            }//if
+
+            total += __builtin_popcountll(bits);
+            pos = blockBegin + 64;
+        }//while
+
+        return total;
+    }//count
+};//ClassifiedText
+
+//Fill in text for [begin, end), using SIMD where it can
+void classifyText(const char *begin, const char *end, ClassifiedText &text);
+
+//Same, going through the ctype calls one character at a time. This is what classifyText falls back to.
+void classifyTextScalar(const char *begin, const char *end, ClassifiedText &text);
+
+//The punctuation test used throughout normalizing
+bool isPunctuation(char c);
+
+#endif
+
@@ -13,6 +13,7 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 #include "../product.h"
 #include <iostream>
 #include <stack>
+#include <string.h>
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
 #include <boost/lambda/lambda.hpp>
@@ -20,50 +21,36 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 #include <boost/thread.hpp>
 
 
-//To bridge boost mem_fn and tr1 -- can't be in the anonymous namespace
-template<class T> const T* get_pointer(const std::tr1::shared_ptr<T>& ptr) 
-{
-    return ptr.get();
-}
-
-template<class T> T* get_pointer(std::tr1::shared_ptr<T>& ptr)
-{
-    return ptr.get();
-}
-
-
-namespace
-{
-
 //This is a helper for the worker threads. We synchronize access to the product stack work through here.
+//Declared in adhoc.h so it can be set up before matching starts (see prepareAdhocProducts).
 class ProductStack
 {
-    std::stack<std::tr1::shared_ptr<Product> > productStack;
+    std::stack<unsigned int> productStack; //indices in Datas
     unsigned int processingCount;
     unsigned int origCount;
     boost::mutex productLock;
 
 public:
-    ProductStack(std::pair<std::vector<std::tr1::shared_ptr<Product> >::iterator, std::vector<std::tr1::shared_ptr<Product> >::iterator> productsPair) 
+    ProductStack(unsigned int numProducts) 
     {
-        BOOST_FOREACH (std::tr1::shared_ptr<Product> product, productsPair) {
-            productStack.push(product);
-        }//foreach
+        for (unsigned int productIndex = 0; productIndex < numProducts; ++productIndex) {
+            productStack.push(productIndex);
+        }//for
 
         processingCount = 0;
         origCount = productStack.size();
     }//constructor
 
-    //Safely grab the next product, pop it from the stack. Returns null if stack is empty.
-    std::tr1::shared_ptr<Product> getNextProduct()
+    //Safely grab the next product's index, pop it from the stack. Returns false if stack is empty.
+    bool getNextProduct(unsigned int &productIndex)
     {
         boost::mutex::scoped_lock lock(productLock);
 
         if (productStack.empty() == true) {
-            return std::tr1::shared_ptr<Product>();
+            return false;
         }//if
 
-        std::tr1::shared_ptr<Product> nextProduct = productStack.top();
+        productIndex = productStack.top();
         productStack.pop();
 
         if ((processingCount % 50) == 0) {
@@ -71,10 +58,13 @@ public:
         }//if
         ++processingCount;
 
-        return nextProduct;
+        return true;
     }//getNextProduct
 };//ProductStack
 
+namespace
+{
+
 //Helper struct for scoring up words in product manufacturer
 struct MatchInfo
 {
@@ -104,34 +94,36 @@ enum FilterMode
     Family
 };//FilterMode
 
-//For each word from the product values, try to match it against the listing values,
+//For each word from the product values, try to match it against the listing values in [listingBegin, listingEnd),
 //keeping info about the result in matchInfos
-void fillMatchInfos(std::vector<MatchInfo> &matchInfos, std::vector<unsigned int> &productValues, std::vector<unsigned int> &listingData,
+void fillMatchInfos(std::vector<MatchInfo> &matchInfos, const std::vector<unsigned int> &productValues, const unsigned int *listingBegin, const unsigned int *listingEnd,
                         std::vector<bool> &matchedListingWords, FilterMode filterMode, StringTable &table)
 {
-    for (std::vector<unsigned int>::iterator productWordIter = productValues.begin(); productWordIter != productValues.end(); ++productWordIter) {
+    for (std::vector<unsigned int>::const_iterator productWordIter = productValues.begin(); productWordIter != productValues.end(); ++productWordIter) {
         MatchInfo matchInfo;
-        std::string &productWordStr = table.getString(*productWordIter);
+        const StringTable::Token &productWord = table.getToken(*productWordIter);
 
-        for (std::vector<unsigned int>::iterator listingWordIter = listingData.begin(); listingWordIter != listingData.end(); ++listingWordIter) {
-            std::string &listingWordStr = table.getString(*listingWordIter);
+        for (const unsigned int *listingWordIter = listingBegin; listingWordIter != listingEnd; ++listingWordIter) {
+            const StringTable::Token &listingWord = table.getToken(*listingWordIter);
 
-            if (listingWordStr.size() < productWordStr.size()) {
+            if (listingWord.length < productWord.length) {
                 continue;
             }//if
 
             //Is the product word at the start or end of the listing word?            
             //Note: We only allow for partial matches with the manufacturer. Exact matching on the model/family worked much better.
             //      Partial matches are only considered at the beginning and end of the listing word
-            bool fullMatch = (listingWordStr == productWordStr);
-            bool partialMatch = ((listingWordStr.substr(0, productWordStr.size()) == productWordStr) || 
-                (listingWordStr.substr(listingWordStr.size() - productWordStr.size(), productWordStr.size()) == productWordStr));
+            //Strings are only in the table once, so equal words have equal keys.
+            bool fullMatch = (*listingWordIter == *productWordIter);
+            bool partialMatch = (Manufacturer == filterMode) &&
+                ((memcmp(listingWord.chars, productWord.chars, productWord.length) == 0) ||
+                 (memcmp(listingWord.chars + listingWord.length - productWord.length, productWord.chars, productWord.length) == 0));
             
             if ( ((Manufacturer == filterMode) && (true == partialMatch)) ||
                  (true == fullMatch) ) {
                 matchInfo.isMatched = true;
-                matchInfo.substringMatchAmount = ((float)productWordStr.size() / ((float)listingWordStr.size()));
-                matchInfo.matchedPosition = std::distance(listingData.begin(), listingWordIter);
+                matchInfo.substringMatchAmount = ((float)productWord.length / ((float)listingWord.length));
+                matchInfo.matchedPosition = listingWordIter - listingBegin;
                 matchInfo.diffPositionFromOriginal = matchInfo.matchedPosition - std::distance(productValues.begin(), productWordIter);
 
                 matchedListingWords[matchInfo.matchedPosition] = true;
@@ -259,16 +251,16 @@ float handOutScores(std::vector<MatchInfo> &matchInfos, FilterMode filterMode)
 }//handOutScores
 
 //The common weight/score calculator. For a given set of product words and listing words (and mode), how well do they match?
-float computeBaseWeight(std::vector<unsigned int> &productValues, std::vector<unsigned int> &listingData, FilterMode filterMode, StringTable &table)
+float computeBaseWeight(const std::vector<unsigned int> &productValues, const unsigned int *listingBegin, const unsigned int *listingEnd, FilterMode filterMode, StringTable &table)
 {
     std::vector<MatchInfo> matchInfos;
     matchInfos.reserve(productValues.size());
 
     std::vector<bool> matchedListingWords;
-    matchedListingWords.resize(listingData.size());
+    matchedListingWords.resize(listingEnd - listingBegin);
 
     //For each word from the product values, try to match it against the listing values
-    fillMatchInfos(matchInfos, productValues, listingData, matchedListingWords, filterMode, table);
+    fillMatchInfos(matchInfos, productValues, listingBegin, listingEnd, matchedListingWords, filterMode, table);
 
     //Compute weight
     float maxScore = (50.0f + 25.0f) * matchInfos.size();
@@ -310,7 +302,7 @@ float computeBaseWeight(std::vector<unsigned int> &productValues, std::vector<un
     //We want to match the manufacturer exactly, so invoke harsh (10%) penalties for each listing manufacturer word not matched
     if (Manufacturer == filterMode) {
         unsigned int matchedCount = std::count_if(matchedListingWords.begin(), matchedListingWords.end(), std::bind2nd(std::equal_to<bool>(), true));
-        float unmatchedWordsPenalty = ((float)(listingData.size() - matchedCount)) * 0.1f;
+        float unmatchedWordsPenalty = ((float)((listingEnd - listingBegin) - matchedCount)) * 0.1f;
 
         curScore -= unmatchedWordsPenalty;
     }//if
@@ -320,21 +312,22 @@ float computeBaseWeight(std::vector<unsigned int> &productValues, std::vector<un
 
 //Compute the match weight/score of the product/listing values then add a normalized
 //version of it to the existing score (common code, so we're adding chunks of the score 
-//at a time)
-void filter(std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > &filteredListings, 
-            std::vector<unsigned int> &productValues, float categoryWeight, 
-            boost::function<std::vector<unsigned int>&(std::tr1::shared_ptr<Listing>)> listingExtractionMethod,
+//at a time). filteredListings holds (listing index, weight) pairs; listingColumn is the listing
+//field the product values are compared against.
+void filter(std::vector<std::pair<unsigned int, float> > &filteredListings, 
+            const std::vector<unsigned int> &productValues, float categoryWeight, 
+            const TokenColumn &listingColumn,
             FilterMode filterMode,
             StringTable &table
             )
 {
-    std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > filteredListingsTmp;
+    std::vector<std::pair<unsigned int, float> > filteredListingsTmp;
     filteredListingsTmp.reserve(filteredListings.size());
 
-    typedef std::pair<std::tr1::shared_ptr<Listing>, float> FilteredListingPair;
-    BOOST_FOREACH (FilteredListingPair &filteredListing, filteredListings) {
-        std::vector<unsigned int> &listingData = listingExtractionMethod(filteredListing.first);
-        float baseWeight = computeBaseWeight(productValues, listingData, filterMode, table);
+    typedef std::pair<unsigned int, float> FilteredListingPair;
+    BOOST_FOREACH (const FilteredListingPair &filteredListing, filteredListings) {
+        float baseWeight = computeBaseWeight(productValues, listingColumn.rowBegin(filteredListing.first), listingColumn.rowEnd(filteredListing.first),
+                                             filterMode, table);
 
         //Normalize computed weight and then add it to the existing value
         float newWeight = filteredListing.second + baseWeight * categoryWeight;
@@ -349,73 +342,61 @@ void filter(std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > &filte
     filteredListings.swap(filteredListingsTmp);
 }//filter
 
-//Compute the portion of the final weight for comparing the manufacturer
-void filterOnManufacturer(std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > &filteredListings, 
-                            std::vector<unsigned int> &manufacturer, 
-                            std::pair<std::vector<std::tr1::shared_ptr<Listing> >::iterator, std::vector<std::tr1::shared_ptr<Listing> >::iterator> listingsPair,
+//Compute the portion of the final weight for comparing the manufacturer, over the corpus' listings in [beginListing, endListing)
+void filterOnManufacturer(std::vector<std::pair<unsigned int, float> > &filteredListings, 
+                            const std::vector<unsigned int> &manufacturer, 
+                            const ListingCorpus &corpus, unsigned int beginListing, unsigned int endListing,
                             StringTable &table)
 {
     //Fill filteredListings
-    filteredListings.reserve(std::distance(listingsPair.first, listingsPair.second));
+    filteredListings.reserve(endListing - beginListing);
 
-    BOOST_FOREACH (std::tr1::shared_ptr<Listing> listing, listingsPair) {
-        filteredListings.push_back(std::make_pair(listing, 0.0f));
-    }//foreach
-
-    //Helper function to pass along to return the manufacturer data without knowing about it
-    boost::function<std::vector<unsigned int>&(std::tr1::shared_ptr<Listing>)> listingExtractionMethod;
-    listingExtractionMethod = boost::lambda::bind(boost::mem_fn(&Listing::getManufacturer), boost::lambda::_1);
+    for (unsigned int listingIndex = beginListing; listingIndex < endListing; ++listingIndex) {
+        filteredListings.push_back(std::make_pair(listingIndex, 0.0f));
+    }//for
 
-    filter(filteredListings, manufacturer, 0.25, listingExtractionMethod, Manufacturer, table);
+    filter(filteredListings, manufacturer, 0.25, corpus.getManufacturers(), Manufacturer, table);
 }//filterOnManufacturer
 
 //Compute the portion of the final weight for comparing the model
-void filterOnModel(std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > &filteredListings, 
-                            std::vector<unsigned int> &model, StringTable &table)
+void filterOnModel(std::vector<std::pair<unsigned int, float> > &filteredListings, 
+                            const std::vector<unsigned int> &model, const ListingCorpus &corpus, StringTable &table)
 {
-    //Helper function to pass along to return the model data without knowing about it
-    boost::function<std::vector<unsigned int>&(std::tr1::shared_ptr<Listing>)> listingExtractionMethod;
-    listingExtractionMethod = boost::lambda::bind(boost::mem_fn(&Listing::getTitle), boost::lambda::_1);
-
-    filter(filteredListings, model, 0.55, listingExtractionMethod, Model, table);
+    filter(filteredListings, model, 0.55, corpus.getTitles(), Model, table);
 }//filterOnModel
 
 //Compute the portion of the final weight for comparing the family
-void filterOnFamily(std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > &filteredListings, 
-                            std::vector<unsigned int> &family, StringTable &table)
+void filterOnFamily(std::vector<std::pair<unsigned int, float> > &filteredListings, 
+                            const std::vector<unsigned int> &family, const ListingCorpus &corpus, StringTable &table)
 {
-    //Helper function to pass along to return the family data without knowing about it
-    boost::function<std::vector<unsigned int>&(std::tr1::shared_ptr<Listing>)> listingExtractionMethod;
-    listingExtractionMethod = boost::lambda::bind(boost::mem_fn(&Listing::getTitle), boost::lambda::_1);
-
-    filter(filteredListings, family, 0.20, listingExtractionMethod, Family, table);
+    filter(filteredListings, family, 0.20, corpus.getTitles(), Family, table);
 }//filterOnFamily
 
 //Simple comparator
-bool sortFilteredListingsComparator(std::pair<std::tr1::shared_ptr<Listing>, float> first, std::pair<std::tr1::shared_ptr<Listing>, float> second)
+bool sortFilteredListingsComparator(const std::pair<unsigned int, float> &first, const std::pair<unsigned int, float> &second)
 {
     return first.second > second.second;
 }//sortFilteredListingsComparator
 
 //Helper to sort filteredListings
-void sortFilteredListings(std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > &filteredListings)
+void sortFilteredListings(std::vector<std::pair<unsigned int, float> > &filteredListings)
 {
     std::sort(filteredListings.begin(), filteredListings.end(), sortFilteredListingsComparator);
 }//sortFilteredListings
 
 //Helper to sort the results
-void sortResult(std::tr1::shared_ptr<ResultHolder> result)
+void sortResult(ResultHolder &result)
 {
-    std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > results;
-    for (unsigned int pos = 0; pos < result->getListings().size(); ++pos) {
-        results.push_back(std::make_pair(result->getListings()[pos], result->getWeights()[pos]));
+    std::vector<std::pair<unsigned int, float> > results;
+    for (unsigned int pos = 0; pos < result.getListings().size(); ++pos) {
+        results.push_back(std::make_pair(result.getListings()[pos], result.getWeights()[pos]));
     }//for
 
     sortFilteredListings(results);
 
     for (unsigned int pos = 0; pos < results.size(); ++pos) {
-        result->getListings()[pos] = results[pos].first;
-        result->getWeights()[pos] = results[pos].second;
+        result.getListings()[pos] = results[pos].first;
+        result.getWeights()[pos] = results[pos].second;
     }//for
 }//sortResult
 
@@ -426,94 +407,150 @@ void productFinalResultsPreAcceptance(Datas &datas)
     //Note: we're not in a worker thread here
 
     //Tell products which listings are best suited for them
-    BOOST_FOREACH (std::tr1::shared_ptr<Listing> listing, datas.getListingPair()) {
-        if (listing->getBestMatchedProduct() == NULL) {
+    for (unsigned int listingIndex = 0; listingIndex < datas.getNumListings(); ++listingIndex) {
+        unsigned int productIndex = datas.matchStates.getBestMatchedProduct(listingIndex);
+        if (MatchStates::noProduct == productIndex) {
             continue;
         }//if
 
-        listing->getBestMatchedProduct()->addMatchedListing(listing);
-    }//foreach
+        datas.getProduct(productIndex)->addMatchedListing(listingIndex);
+    }//for
 
     //Create result list
-    BOOST_FOREACH (std::tr1::shared_ptr<Product> product, datas.getProductPair()) {
+    for (unsigned int productIndex = 0; productIndex < datas.getNumProducts(); ++productIndex) {
+        Product &product = *datas.getProduct(productIndex);
         std::tr1::shared_ptr<ResultHolder> newResult(new ResultHolder);
-        newResult->setProduct(product);
+        newResult->setProduct(productIndex);
 
-        unsigned int numMatchedListings = std::distance(product->getMatchedListingPair().first, product->getMatchedListingPair().second);
+        unsigned int numMatchedListings = std::distance(product.getMatchedListingPair().first, product.getMatchedListingPair().second);
 
         newResult->reserveListings(numMatchedListings);
         newResult->reserveWeights(numMatchedListings);
 
-        BOOST_FOREACH (std::tr1::shared_ptr<Listing> listing, product->getMatchedListingPair()) {
-            newResult->addListing(listing);
-            newResult->addWeight(listing->getBestMatchedWeight());
+        BOOST_FOREACH (unsigned int listingIndex, product.getMatchedListingPair()) {
+            newResult->addListing(listingIndex);
+            newResult->addWeight(datas.matchStates.getBestMatchedWeight(listingIndex));
         }//foreach
 
         //We don't need to, but let's sort the results by weight
-        sortResult(newResult);
+        sortResult(*newResult);
 
         datas.addResult(newResult);
-    }//foreach
+    }//for
 }//productFinalResultsPreAcceptance
 
-//The real thread function. Applies scoring/filtering on the listing data for a single
+//The real thread function. Applies scoring/filtering on the listing data (in [beginListing, endListing)) for a single
 //product, ultimately updating the listing with the better product matching (if found
 //for the given listing and product). 
 //The final product->listings mapping isn't done until after the threads have finished.
-void determineListingsForProduct(Datas &datas, std::tr1::shared_ptr<Product> product)
+void determineListingsForProduct(Datas &datas, unsigned int productIndex, unsigned int beginListing, unsigned int endListing, AdhocMatchingMode mode)
 {
-    std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > filteredListings; //pair of (listing, weight)
+    Product &product = *datas.getProduct(productIndex);
 
-    //Filter the list of listings a little and then compute weights for the ones that survive the cull
-    filterOnManufacturer(filteredListings, product->getManufacturer(), datas.getListingPair(), datas.stringTable);
-    filterOnModel(filteredListings, product->getModel(), datas.stringTable);
-    filterOnFamily(filteredListings, product->getFamily(), datas.stringTable);
+    std::vector<std::pair<unsigned int, float> > filteredListings; //pair of (listing index, weight)
 
-    //If this product is a better match for a listing, then update the listing to reflect that
-    for (std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> >::iterator filteredListingsIter = filteredListings.begin(); 
+    //Filter the list of listings a little and then compute weights for the ones that survive the cull
+    filterOnManufacturer(filteredListings, product.getManufacturer(), datas.listingCorpus, beginListing, endListing, datas.stringTable);
+    filterOnModel(filteredListings, product.getModel(), datas.listingCorpus, datas.stringTable);
+    filterOnFamily(filteredListings, product.getFamily(), datas.listingCorpus, datas.stringTable);
+
+    //If this product is a better match for a listing, then update the listing to reflect that.
+    //Matching by product, other threads may be doing the same to the same listings; offerMatch sorts
+    //that out without a lock. Partitioned by listing, this thread is the only one with these listings.
+    for (std::vector<std::pair<unsigned int, float> >::iterator filteredListingsIter = filteredListings.begin(); 
         filteredListingsIter != filteredListings.end(); ++filteredListingsIter) {
-
-        std::tr1::shared_ptr<Listing> curListing = filteredListingsIter->first;
-
-        {
-        boost::mutex::scoped_lock lock(curListing->getListingLock());
-
-        if (filteredListingsIter->second > curListing->getBestMatchedWeight()) {
-            curListing->setBestMatchedProduct(product);
-            curListing->setBestMatchedWeight(filteredListingsIter->second);
+        if (ListingPartitionedMatching == mode) {
+            datas.matchStates.offerOwnedMatch(filteredListingsIter->first, productIndex, filteredListingsIter->second);
+        } else {
+            datas.matchStates.offerMatch(filteredListingsIter->first, productIndex, filteredListingsIter->second);
         }//if
-        }
     }//for
 }//determineListingsForProduct
 
 //Thread worker function.. grab a product, match it up against all the listings.
 //Repeat until no more products.
-void workerThreadStart(std::tr1::shared_ptr<ProductStack> productStack, Datas &datas)
+void workerThreadStart(std::tr1::shared_ptr<ProductStack> productStack, Datas &datas, unsigned int firstListing)
 {
-    std::tr1::shared_ptr<Product> curProduct = productStack->getNextProduct();
-    while (curProduct != NULL) {
-        determineListingsForProduct(datas, curProduct);
-
-        //Product stack synchronizes the getter for us
-        curProduct = productStack->getNextProduct();
+    //Product stack synchronizes the getter for us
+    unsigned int productIndex = 0;
+    while (productStack->getNextProduct(productIndex) == true) {
+        determineListingsForProduct(datas, productIndex, firstListing, datas.listingCorpus.getNumListings(), ProductParallelMatching);
     }//while
 }//workerThreadStart
 
+//Thread worker function for listing partitioned matching: match every product against the listings
+//in [beginListing, endListing), which no other thread touches.
+void partitionWorkerThreadStart(Datas &datas, unsigned int beginListing, unsigned int endListing)
+{
+    //Same order as the product stack hands them out, not that it changes the results
+    for (unsigned int productIndex = datas.getNumProducts(); productIndex > 0; --productIndex) {
+        determineListingsForProduct(datas, productIndex - 1, beginListing, endListing, ListingPartitionedMatching);
+    }//for
+}//partitionWorkerThreadStart
+
+//Where thread's range of the listings from firstListing on starts when they're split up numThreads ways.
+//Ranges start on a cache line of the match states, so no two threads ever write to the same line.
+unsigned int partitionBegin(unsigned int thread, unsigned int numThreads, unsigned int firstListing, unsigned int numListings)
+{
+    if (0 == thread) {
+        return firstListing;
+    }//if
+
+    unsigned long long begin = firstListing + (unsigned long long)(numListings - firstListing) * thread / numThreads;
+    begin = (begin + MatchStates::listingsPerCacheLine - 1) / MatchStates::listingsPerCacheLine * MatchStates::listingsPerCacheLine;
+
+    return (begin < numListings) ? begin : numListings;
+}//partitionBegin
+
 }//anonymous namespace
 
+//The normalized fields the adhoc matcher reads: the filters above compare the product's manufacturer,
+//model and family against the listing's manufacturer and title. Keep this in step with them.
+FieldSet adhocMatchingFields()
+{
+    return FieldSet(Listing::TitleField | Listing::ManufacturerField,
+                    Product::ManufacturerField | Product::FamilyField | Product::ModelField);
+}//adhocMatchingFields
+
+//Set up the product side of the matching. Only needs the products, not the listings.
+std::tr1::shared_ptr<ProductStack> prepareAdhocProducts(Datas &datas)
+{
+    return std::tr1::shared_ptr<ProductStack>(new ProductStack(datas.getNumProducts()));
+}//prepareAdhocProducts
+
 //Determine the product->listings matchings. Spawn off N threads and go from there.
-void doAdhocMatching(Datas &datas, unsigned int numThreads)
+void doAdhocMatching(Datas &datas, unsigned int numThreads, unsigned int firstListing, AdhocMatchingMode mode)
 {
-    std::tr1::shared_ptr<ProductStack> productStack(new ProductStack(datas.getProductPair()));
+    doAdhocMatching(datas, prepareAdhocProducts(datas), numThreads, firstListing, mode);
+}//doAdhocMatching
 
+//Same, with the product side already set up
+void doAdhocMatching(Datas &datas, std::tr1::shared_ptr<ProductStack> productStack, unsigned int numThreads, unsigned int firstListing,
+                     AdhocMatchingMode mode)
+{
     std::vector<std::tr1::shared_ptr<boost::function<void (void)> > > threadFuncPool;
     std::vector<std::tr1::shared_ptr<boost::thread> > threadPool;
 
+    //The threads only read the listings' tokens, through the corpus, and only write their matches.
+    //Listings from before firstListing keep the matches they have.
+    datas.matchStates.resize(datas.getNumListings());
+
     //Start threads
     for (unsigned int thread = 0; thread < numThreads; ++thread) {
-        std::tr1::shared_ptr<boost::function<void (void)> > threadStartFunc(
-                new boost::function<void (void)>(boost::lambda::bind(&workerThreadStart, boost::lambda::var(productStack), boost::lambda::var(datas)))
-            );
+        std::tr1::shared_ptr<boost::function<void (void)> > threadStartFunc;
+        if (ListingPartitionedMatching == mode) {
+            unsigned int beginListing = partitionBegin(thread, numThreads, firstListing, datas.getNumListings());
+            unsigned int endListing = partitionBegin(thread + 1, numThreads, firstListing, datas.getNumListings());
+            if (beginListing == endListing) {
+                continue;
+            }//if
+
+            threadStartFunc.reset(new boost::function<void (void)>(
+                    boost::lambda::bind(&partitionWorkerThreadStart, boost::lambda::var(datas), beginListing, endListing)));
+        } else {
+            threadStartFunc.reset(new boost::function<void (void)>(
+                    boost::lambda::bind(&workerThreadStart, boost::lambda::var(productStack), boost::lambda::var(datas), firstListing)));
+        }//if
 
         threadFuncPool.push_back(threadStartFunc);
         threadPool.push_back(std::tr1::shared_ptr<boost::thread>(new boost::thread(*threadStartFunc)));
@@ -8,93 +8,76 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 
 #include "adhoc.h"
 #include "../stringTable.h"
-#include <sstream>
-#include <boost/foreach.hpp>
-#include <boost/array.hpp>
-#include <limits>
-#include <ctype.h>
+#include "normalizePipeline.h"
+#include <boost/thread/tss.hpp>
 
 namespace
 {
 
-//If we had a large number we could turn this into a hash table
-//This represents words that we're confident have no meaning and would be
-//better removed
-const unsigned int numNoiseEntries = 9;
-boost::array<std::string, numNoiseEntries> NoiseEntries = {{
-    "gmbh", "inc", "ltd", "uk", "corporation", "international", "llc", "co", "plc"
-}};//NoiseEntries
-
-bool isPunctuation(char c)
-{
-    if (ispunct(c) != 0) {
-        return true;
-    } else {
-        switch (c) {
-            case '(':
-            case ')':
-                return true;
-
-            default:
-                ;
-                //Nothing
-        }//switch
-
-        return false;
-    }//if
-}//isPunctuation
-
-//Given a string, remove leading and trailing punctuation and filter out 
-//common "useless" words
-std::string transmuteString(const std::string &str)
+//Words that we're confident have no meaning and would be better removed
+struct CompanyNoiseWords
 {
-    if (str.empty() == true) {
-        return "";
-    }//if
+    static const unsigned int numWords = 9;
+    static constexpr const char *words[numWords] = {
+        "gmbh", "inc", "ltd", "uk", "corporation", "international", "llc", "co", "plc"
+    };
+};//CompanyNoiseWords
 
-    //remove leading and trailing punctuation
-    unsigned int firstNonPunctuationPos = std::numeric_limits<unsigned int>::max();
-    unsigned int lastNonPunctuationPos = 0;
-    for (unsigned int pos = 0; pos < str.length(); ++pos) {
-        if ((std::numeric_limits<unsigned int>::max() == firstNonPunctuationPos) && (isPunctuation(str[pos]) == false)) {
-            firstNonPunctuationPos = pos;
-        }//if
-
-        //Could duplicate the loop and march backwards to save ourselves a little bit of work
-        if (isPunctuation(str[pos]) == false) {
-            lastNonPunctuationPos = pos;
-        }//if
-    }//foreach
+constexpr const char *CompanyNoiseWords::words[];
 
-    if (std::numeric_limits<unsigned int>::max() == firstNonPunctuationPos) {
-        return "";
-    }//if
+//What decides whether a word is kept: once trimmed it has to be more than one character long and
+//not be common "useless" noise
+typedef NormalizePipeline<DropShortWords<2>, DropNoiseWords<CompanyNoiseWords> > AdhocWordPipeline;
 
-    if (firstNonPunctuationPos == lastNonPunctuationPos) {
-        //Shouldn't get in here
-        return "";
-    }//if
+//Scratch space for adhocStringNormalize callers which don't bring their own, one per thread
+boost::thread_specific_ptr<NormalizeBuffer> threadNormalizeBuffer;
 
-    std::string curStr = str.substr(firstNonPunctuationPos, lastNonPunctuationPos - firstNonPunctuationPos + 1);
+}//anonymous namespace
 
-    //filter out common noise
-    bool isNoise = false;
-    BOOST_FOREACH (std::string &noiseStr, NoiseEntries) {
-        if (curStr == noiseStr) {
-            isNoise = true;
-            break;
+//Normalize [begin, end) into a set of words, appending their ids to words. The text is classified
+//up front (see charClasses.h); words are then split on whitespace, lower cased and have their dashes
+//dropped as they're copied into the buffer's word. A word is kept if, once its leading and trailing
+//punctuation is trimmed, it makes it through AdhocWordPipeline; what goes in the string table is still
+//the untrimmed word.
+void adhocStringNormalize(const char *begin, const char *end, StringTable &stringTable, std::vector<unsigned int> &words, NormalizeBuffer &buffer)
+{
+    ClassifiedText &text = buffer.text;
+    std::string &word = buffer.word;
+
+    classifyText(begin, end, text);
+
+    size_t wordBegin = text.findNext(text.spaceMasks, 0, text.length, false);
+    while (wordBegin < text.length) {
+        size_t wordEnd = text.findNext(text.spaceMasks, wordBegin, text.length, true);
+
+        //Copy the word over without its dashes
+        word.clear();
+        size_t piecePos = wordBegin;
+        while (piecePos < wordEnd) {
+            size_t dashPos = text.findNext(text.dashMasks, piecePos, wordEnd, true);
+            word.append(text.lowered, piecePos, dashPos - piecePos);
+            piecePos = dashPos + 1;
+        }//while
+
+        //Where the word's first and last non punctuation characters ended up once the dashes were dropped
+        size_t firstNonPunctuationPos = text.findNext(text.punctuationMasks, wordBegin, wordEnd, false);
+        size_t lastNonPunctuationPos = 0;
+        if (firstNonPunctuationPos != wordEnd) {
+            lastNonPunctuationPos = text.findLastNotSet(text.punctuationMasks, wordBegin, wordEnd);
+            lastNonPunctuationPos -= wordBegin + text.count(text.dashMasks, wordBegin, lastNonPunctuationPos);
+            firstNonPunctuationPos -= wordBegin + text.count(text.dashMasks, wordBegin, firstNonPunctuationPos);
+        } else {
+            firstNonPunctuationPos = std::string::npos;
         }//if
-    }//foreach
-    
-    if (true == isNoise) {
-        return "";
-    }//if
 
-    //The normalized string
-    return curStr;
-}//transmuteString
+        NormalizedWord normalizedWord(word, firstNonPunctuationPos, lastNonPunctuationPos);
+        if (AdhocWordPipeline::apply(normalizedWord) == true) {
+            words.push_back(stringTable.getStringVal(word));
+        }//if
 
-}//anonymous namespace
+        wordBegin = text.findNext(text.spaceMasks, wordEnd, text.length, false);
+    }//while
+}//adhocStringNormalize
 
 //Normalize a string into a set of words represented as a vector of ints
 std::vector<unsigned int> adhocStringNormalize(const std::string &str, StringTable &stringTable)
@@ -105,37 +88,11 @@ std::vector<unsigned int> adhocStringNormalize(const std::string &str, StringTab
         return retStr;
     }//if
 
-    std::vector<std::string> stringBits;
-
-    //Gather up vector of words from original string
-    std::istringstream tmpSS(str);
-    do {
-        std::string subStr;
-        tmpSS >> subStr;
-
-        //Everything lower case
-        std::transform(subStr.begin(), subStr.end(), subStr.begin(), ::tolower);
-
-        //Remove any dashes in middle of string
-        size_t dashPos;
-        do {
-            dashPos = subStr.find('-');
-
-            if (dashPos != std::string::npos) {
-                subStr.erase(dashPos, 1);
-            }//if
-        } while (dashPos != std::string::npos);
-
-        stringBits.push_back(subStr);
-    } while(tmpSS);
+    if (threadNormalizeBuffer.get() == NULL) {
+        threadNormalizeBuffer.reset(new NormalizeBuffer);
+    }//if
 
-    //For each word, normalize it and then place it into our string table
-    BOOST_FOREACH (std::string &subStr, stringBits) {
-        std::string transmutedString = transmuteString(subStr);
-        if (transmutedString.empty() == false) {
-            retStr.push_back(stringTable.getStringVal(subStr));
-        }//if
-    }//foreach
+    adhocStringNormalize(str.data(), str.data() + str.size(), stringTable, retStr, *threadNormalizeBuffer);
 
     return retStr;
 }//adhocStringNormalize
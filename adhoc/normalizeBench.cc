@@ -0,0 +1,138 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+//Microbenchmark for the character classification done while normalizing: the SIMD kernel against
+//the ctype calls it replaced. Every line of the given file is classified both ways (and checked to
+//come out the same), then normalized as a whole.
+//
+//  make normalize-bench && ./normalize-bench listings.txt [rounds]
+
+#include "adhoc.h"
+#include "charClasses.h"
+#include "../stringTable.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace
+{
+
+double now()
+{
+    timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec / 1000000.0;
+}//now
+
+typedef void (*ClassifyFunction)(const char *, const char *, ClassifiedText &);
+
+//Classify every line rounds times, returning the seconds taken
+double timeClassify(ClassifyFunction classify, const std::vector<std::string> &lines, unsigned int rounds, size_t &checksum)
+{
+    ClassifiedText text;
+
+    double start = now();
+    for (unsigned int round = 0; round < rounds; ++round) {
+        BOOST_FOREACH (const std::string &line, lines) {
+            classify(line.data(), line.data() + line.size(), text);
+            checksum += text.spaceMasks.empty() ? 0 : text.spaceMasks[0] + text.punctuationMasks[0];
+        }//foreach
+    }//for
+
+    return now() - start;
+}//timeClassify
+
+bool sameClasses(const ClassifiedText &first, const ClassifiedText &second)
+{
+    return (first.length == second.length) &&
+           (first.lowered.compare(0, first.length, second.lowered, 0, second.length) == 0) &&
+           (first.spaceMasks == second.spaceMasks) &&
+           (first.dashMasks == second.dashMasks) &&
+           (first.punctuationMasks == second.punctuationMasks);
+}//sameClasses
+
+}//anonymous namespace
+
+int main(int argc, const char* argv[])
+{
+    if ((argc != 2) && (argc != 3)) {
+        std::cout << "Usage: " << argv[0] << " <file> [rounds]" << std::endl;
+        return -1;
+    }//if
+
+    unsigned int rounds = 10;
+    if (3 == argc) {
+        try {
+            rounds = boost::lexical_cast<unsigned int>(argv[2]);
+        } catch (boost::bad_lexical_cast &) {
+            std::cout << "Bad number of rounds '" << argv[2] << "'" << std::endl;
+            return -1;
+        }//try
+    }//if
+
+    std::ifstream inFile(argv[1]);
+    if (!inFile) {
+        std::cout << "Failed to open '" << argv[1] << "'" << std::endl;
+        return -1;
+    }//if
+
+    std::vector<std::string> lines;
+    size_t numBytes = 0;
+    std::string line;
+    while (std::getline(inFile, line)) {
+        numBytes += line.size();
+        lines.push_back(line);
+    }//while
+
+    ClassifiedText scalarText;
+    ClassifiedText simdText;
+    BOOST_FOREACH (const std::string &line, lines) {
+        classifyTextScalar(line.data(), line.data() + line.size(), scalarText);
+        classifyText(line.data(), line.data() + line.size(), simdText);
+        if (sameClasses(scalarText, simdText) == false) {
+            std::cout << "Classifications differ for line '" << line << "'" << std::endl;
+            return -1;
+        }//if
+    }//foreach
+
+    size_t checksum = 0;
+    double scalarTime = timeClassify(&classifyTextScalar, lines, rounds, checksum);
+    double simdTime = timeClassify(&classifyText, lines, rounds, checksum);
+
+    //Whole normalization, with the string table already holding every word
+    StringTable stringTable;
+    NormalizeBuffer buffer;
+    std::vector<unsigned int> words;
+    double normalizeTime = 0.0;
+    for (unsigned int round = 0; round <= rounds; ++round) {
+        double start = now();
+        BOOST_FOREACH (const std::string &line, lines) {
+            words.clear();
+            adhocStringNormalize(line.data(), line.data() + line.size(), stringTable, words, buffer);
+            checksum += words.size();
+        }//foreach
+
+        if (round != 0) {
+            normalizeTime += now() - start;
+        }//if
+    }//for
+
+    double megabytes = (double)numBytes * rounds / (1024.0 * 1024.0);
+    std::cout << lines.size() << " lines, " << numBytes << " bytes, " << rounds << " rounds" << std::endl;
+    std::cout << "classify (ctype):  " << scalarTime << "s, " << megabytes / scalarTime << " MB/s" << std::endl;
+    std::cout << "classify (simd):   " << simdTime << "s, " << megabytes / simdTime << " MB/s" << std::endl;
+    std::cout << "normalize (whole): " << normalizeTime << "s, " << megabytes / normalizeTime << " MB/s" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+
+    return 0;
+}//main
+
@@ -0,0 +1,82 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#include "normalizeCache.h"
+#include "adhoc.h"
+
+//The normalized form of str, shared with every other caller asking for the same str
+SharedTokens NormalizeCache::normalize(const std::string &str)
+{
+    Shard &shard = shards[std::hash<std::string>()(str) % numShards];
+
+    {
+    boost::mutex::scoped_lock lock(shard.shardLock);
+
+    std::unordered_map<std::string, SharedTokens>::iterator entryIter = shard.entries.find(str);
+    if (entryIter != shard.entries.end()) {
+        ++shard.hits;
+        return entryIter->second;
+    }//if
+
+    ++shard.misses;
+    }
+
+    //Normalize outside the lock. If another thread gets there first with the same value, theirs is kept.
+    SharedTokens tokens(new std::vector<unsigned int>(adhocStringNormalize(str, stringTable)));
+
+    boost::mutex::scoped_lock lock(shard.shardLock);
+
+    if (shard.entries.size() >= maxEntriesPerShard) {
+        return tokens;
+    }//if
+
+    return shard.entries.insert(std::make_pair(str, tokens)).first->second;
+}//normalize
+
+unsigned long NormalizeCache::getHits()
+{
+    unsigned long hits = 0;
+    for (unsigned int shardNum = 0; shardNum < numShards; ++shardNum) {
+        boost::mutex::scoped_lock lock(shards[shardNum].shardLock);
+        hits += shards[shardNum].hits;
+    }//for
+
+    return hits;
+}//getHits
+
+unsigned long NormalizeCache::getMisses()
+{
+    unsigned long misses = 0;
+    for (unsigned int shardNum = 0; shardNum < numShards; ++shardNum) {
+        boost::mutex::scoped_lock lock(shards[shardNum].shardLock);
+        misses += shards[shardNum].misses;
+    }//for
+
+    return misses;
+}//getMisses
+
+size_t NormalizeCache::getNumEntries()
+{
+    size_t numEntries = 0;
+    for (unsigned int shardNum = 0; shardNum < numShards; ++shardNum) {
+        boost::mutex::scoped_lock lock(shards[shardNum].shardLock);
+        numEntries += shards[shardNum].entries.size();
+    }//for
+
+    return numEntries;
+}//getNumEntries
+
+//Forget every value
+void NormalizeCache::clear()
+{
+    for (unsigned int shardNum = 0; shardNum < numShards; ++shardNum) {
+        boost::mutex::scoped_lock lock(shards[shardNum].shardLock);
+        std::unordered_map<std::string, SharedTokens>().swap(shards[shardNum].entries);
+    }//for
+}//clear
+
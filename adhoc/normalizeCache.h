@@ -0,0 +1,64 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __NORMALIZECACHE_H
+#define __NORMALIZECACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <boost/thread/mutex.hpp>
+#include "../stringTable.h"
+
+//Remembers what adhocStringNormalize made of a field value, for fields like the manufacturer where a
+//few hundred values cover millions of records. A value seen before skips normalizing altogether, and
+//everyone asking for it gets the same token array. Any number of threads can share a cache; it's
+//split into shards by hash, each with its own lock.
+//
+//Once the cache holds maxEntries values it stops taking new ones, so a field which hardly ever
+//repeats can't grow it without bound. Those values are still normalized, just not remembered.
+class NormalizeCache
+{
+    static const unsigned int numShards = 16;
+
+    //Cache line aligned, like StringTable's shards
+    struct __attribute__((aligned(64))) Shard
+    {
+        boost::mutex shardLock;
+        std::unordered_map<std::string, SharedTokens> entries;
+        unsigned long hits;
+        unsigned long misses;
+
+        Shard() : hits(0), misses(0) {}
+    };//Shard
+
+    StringTable &stringTable;
+    Shard shards[numShards];
+    size_t maxEntriesPerShard;
+
+    NormalizeCache(const NormalizeCache &);
+    NormalizeCache &operator=(const NormalizeCache &);
+
+public:
+    NormalizeCache(StringTable &stringTable_, size_t maxEntries = 64 * 1024)
+        : stringTable(stringTable_), maxEntriesPerShard(maxEntries / numShards + 1)
+    {
+    }//constructor
+
+    //The normalized form of str, shared with every other caller asking for the same str
+    SharedTokens normalize(const std::string &str);
+
+    unsigned long getHits();
+    unsigned long getMisses();
+    size_t getNumEntries();
+
+    //Forget every value. Token arrays already handed out stay good.
+    void clear();
+};//NormalizeCache
+
+#endif
+
@@ -0,0 +1,202 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __NORMALIZEPIPELINE_H
+#define __NORMALIZEPIPELINE_H
+
+#include <string>
+#include <string.h>
+#include <stdint.h>
+
+//What happens to each word once normalizing has split it out of the text (lower cased and without
+//its dashes, see charClasses.h) is a pipeline of stages put together at compile time:
+//
+//  typedef NormalizePipeline<DropShortWords<2>, DropNoiseWords<CompanyNoiseWords> > WordPipeline;
+//
+//A stage is a type with a static apply(NormalizedWord &) that can change the word and returns false
+//to drop it, which skips the stages after it. Everything is static and inline, so the compiler sees
+//the whole pipeline as one function; there's no virtual call or table of stages to walk per word.
+
+//A word going through the pipeline
+struct NormalizedWord
+{
+    std::string &text;
+    size_t firstNonPunctuationPos; //npos if the word is all punctuation
+    size_t lastNonPunctuationPos;
+
+    NormalizedWord(std::string &text_, size_t firstNonPunctuationPos_, size_t lastNonPunctuationPos_)
+        : text(text_), firstNonPunctuationPos(firstNonPunctuationPos_), lastNonPunctuationPos(lastNonPunctuationPos_)
+    {
+    }//constructor
+
+    //Length once leading and trailing punctuation is trimmed off
+    size_t trimmedLength() const
+    {
+        return (std::string::npos == firstNonPunctuationPos) ? 0 : lastNonPunctuationPos - firstNonPunctuationPos + 1;
+    }//trimmedLength
+};//NormalizedWord
+
+template <class... Stages>
+struct NormalizePipeline;
+
+template <>
+struct NormalizePipeline<>
+{
+    static bool apply(NormalizedWord &) { return true; }
+};//NormalizePipeline
+
+template <class Stage, class... Stages>
+struct NormalizePipeline<Stage, Stages...>
+{
+    static bool apply(NormalizedWord &word) { return Stage::apply(word) && NormalizePipeline<Stages...>::apply(word); }
+};//NormalizePipeline
+
+//Compile time machinery for StaticWordSet
+namespace staticWordSet
+{
+
+//FNV-1a, one version for the compiler over a null terminated word and one for run time over a range
+constexpr uint32_t hashWord(const char *word, uint32_t hash)
+{
+    return ('\0' == *word) ? hash : hashWord(word + 1, (hash ^ (unsigned char)*word) * 16777619u);
+}//hashWord
+
+inline uint32_t hashChars(const char *chars, size_t length, uint32_t hash)
+{
+    for (size_t pos = 0; pos < length; ++pos) {
+        hash = (hash ^ (unsigned char)chars[pos]) * 16777619u;
+    }//for
+
+    return hash;
+}//hashChars
+
+constexpr uint32_t seedHash(uint32_t seed)
+{
+    return 2166136261u ^ (seed * 0x9e3779b9u);
+}//seedHash
+
+constexpr unsigned int tableSizeFor(unsigned int numWords, unsigned int tableSize = 1)
+{
+    return (tableSize >= 4 * numWords) ? tableSize : tableSizeFor(numWords, tableSize * 2);
+}//tableSizeFor
+
+template <class WordList>
+constexpr unsigned int slotOf(unsigned int word, uint32_t seed, unsigned int tableSize)
+{
+    return hashWord(WordList::words[word], seedHash(seed)) & (tableSize - 1);
+}//slotOf
+
+template <class WordList>
+constexpr bool collidesWithLater(unsigned int word, unsigned int laterWord, uint32_t seed, unsigned int tableSize)
+{
+    return (laterWord >= WordList::numWords) ? false :
+        ((slotOf<WordList>(word, seed, tableSize) == slotOf<WordList>(laterWord, seed, tableSize)) ||
+         collidesWithLater<WordList>(word, laterWord + 1, seed, tableSize));
+}//collidesWithLater
+
+template <class WordList>
+constexpr bool hasCollisions(unsigned int word, uint32_t seed, unsigned int tableSize)
+{
+    return (word >= WordList::numWords) ? false :
+        (collidesWithLater<WordList>(word, word + 1, seed, tableSize) || hasCollisions<WordList>(word + 1, seed, tableSize));
+}//hasCollisions
+
+//The first seed which gives every word its own slot
+template <class WordList>
+constexpr uint32_t findSeed(uint32_t seed, unsigned int tableSize)
+{
+    return (hasCollisions<WordList>(0, seed, tableSize) == false) ? seed : findSeed<WordList>(seed + 1, tableSize);
+}//findSeed
+
+//Which word is in a slot, -1 for none
+template <class WordList>
+constexpr int slotOwner(unsigned int slot, unsigned int word, uint32_t seed, unsigned int tableSize)
+{
+    return (word >= WordList::numWords) ? -1 :
+        ((slotOf<WordList>(word, seed, tableSize) == slot) ? (int)word : slotOwner<WordList>(slot, word + 1, seed, tableSize));
+}//slotOwner
+
+template <unsigned int... Indices>
+struct IndexList {};
+
+template <unsigned int Count, unsigned int... Indices>
+struct MakeIndexList : MakeIndexList<Count - 1, Count - 1, Indices...> {};
+
+template <unsigned int... Indices>
+struct MakeIndexList<0, Indices...>
+{
+    typedef IndexList<Indices...> type;
+};//MakeIndexList
+
+template <class WordList, uint32_t Seed, class Slots>
+struct SlotTable;
+
+template <class WordList, uint32_t Seed, unsigned int... Slots>
+struct SlotTable<WordList, Seed, IndexList<Slots...> >
+{
+    static const signed char owners[sizeof...(Slots)];
+};//SlotTable
+
+template <class WordList, uint32_t Seed, unsigned int... Slots>
+const signed char SlotTable<WordList, Seed, IndexList<Slots...> >::owners[sizeof...(Slots)] = {
+    (signed char)slotOwner<WordList>(Slots, 0, Seed, sizeof...(Slots))...
+};
+
+}//namespace staticWordSet
+
+//A set of words fixed at compile time. WordList has a constexpr array of numWords strings, words.
+//The compiler works out a seed for which the words' hashes all land in different slots, and which
+//word is in which slot, so a lookup is one hash, one slot and one compare.
+template <class WordList>
+class StaticWordSet
+{
+    static const unsigned int tableSize = staticWordSet::tableSizeFor(WordList::numWords);
+    static const uint32_t seed = staticWordSet::findSeed<WordList>(0, tableSize);
+
+    typedef staticWordSet::SlotTable<WordList, seed, typename staticWordSet::MakeIndexList<tableSize>::type> Slots;
+
+public:
+    static bool contains(const char *chars, size_t length)
+    {
+        uint32_t hash = staticWordSet::hashChars(chars, length, staticWordSet::seedHash(seed));
+        int owner = Slots::owners[hash & (tableSize - 1)];
+        if (owner < 0) {
+            return false;
+        }//if
+
+        const char *word = WordList::words[owner];
+        return (strlen(word) == length) && (memcmp(word, chars, length) == 0);
+    }//contains
+};//StaticWordSet
+
+//Drops words which are shorter than MinLength once trimmed, including the ones that are all punctuation
+template <unsigned int MinLength>
+struct DropShortWords
+{
+    static bool apply(NormalizedWord &word)
+    {
+        return (std::string::npos != word.firstNonPunctuationPos) && (word.trimmedLength() >= MinLength);
+    }//apply
+};//DropShortWords
+
+//Drops words which, once trimmed, are in WordList (see StaticWordSet)
+template <class WordList>
+struct DropNoiseWords
+{
+    static bool apply(NormalizedWord &word)
+    {
+        if (std::string::npos == word.firstNonPunctuationPos) {
+            return true;
+        }//if
+
+        return StaticWordSet<WordList>::contains(word.text.data() + word.firstNonPunctuationPos, word.trimmedLength()) == false;
+    }//apply
+};//DropNoiseWords
+
+#endif
+
@@ -0,0 +1,107 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __BOUNDEDQUEUE_H
+#define __BOUNDEDQUEUE_H
+
+#include <deque>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+//A fixed capacity queue between the threads of two stages. push() waits while the queue is full
+//and pop() while it's empty, so a fast stage can't run away from a slow one.
+//The queue is finished once each of its producers has called close(), and pop() then fails as soon
+//as it's empty. abort() finishes it straight away: whatever is queued is dropped and both push()
+//and pop() fail from then on.
+template <class T>
+class BoundedQueue
+{
+    std::deque<T> items;
+    size_t capacity;
+    unsigned int openProducers;
+    bool aborted;
+
+    boost::mutex queueLock;
+    boost::condition_variable notFull;
+    boost::condition_variable notEmpty;
+
+    BoundedQueue(const BoundedQueue &);
+    BoundedQueue &operator=(const BoundedQueue &);
+
+public:
+    BoundedQueue(size_t capacity_, unsigned int numProducers)
+        : capacity(capacity_ > 0 ? capacity_ : 1), openProducers(numProducers), aborted(false)
+    {
+    }//constructor
+
+    //Returns false if the queue was aborted
+    bool push(const T &item)
+    {
+        boost::mutex::scoped_lock lock(queueLock);
+
+        while ((false == aborted) && (items.size() >= capacity)) {
+            notFull.wait(lock);
+        }//while
+
+        if (true == aborted) {
+            return false;
+        }//if
+
+        items.push_back(item);
+        notEmpty.notify_one();
+
+        return true;
+    }//push
+
+    //Returns false once the queue is finished and empty, or was aborted
+    bool pop(T &item)
+    {
+        boost::mutex::scoped_lock lock(queueLock);
+
+        while ((false == aborted) && items.empty() && (openProducers > 0)) {
+            notEmpty.wait(lock);
+        }//while
+
+        if ((true == aborted) || items.empty()) {
+            return false;
+        }//if
+
+        item = items.front();
+        items.pop_front();
+        notFull.notify_one();
+
+        return true;
+    }//pop
+
+    //A producer is done pushing
+    void close()
+    {
+        boost::mutex::scoped_lock lock(queueLock);
+
+        if (openProducers > 0) {
+            --openProducers;
+        }//if
+
+        if (0 == openProducers) {
+            notEmpty.notify_all();
+        }//if
+    }//close
+
+    void abort()
+    {
+        boost::mutex::scoped_lock lock(queueLock);
+
+        aborted = true;
+        items.clear();
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }//abort
+};//BoundedQueue
+
+#endif
+
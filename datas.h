@@ -13,31 +13,48 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 #include <tr1/memory>
 #include <map>
 #include "stringTable.h"
+#include "listingCorpus.h"
+#include "matchStates.h"
+#include "adhoc/normalizeCache.h"
 
 struct Listing;
 struct Product;
 
-//Represents the list of listings for a given product (and their associated weight)
+//Represents the list of listings for a given product (and their associated weight).
+//The product and listings are indices in Datas, which owns them.
 class ResultHolder
 {
-    std::tr1::shared_ptr<Product> product;
-    std::vector<std::tr1::shared_ptr<Listing> > listings;
+    unsigned int product;
+    std::vector<unsigned int> listings;
     std::vector<float> weights;
 
 public:    
-    std::tr1::shared_ptr<Product> getProduct() { return product; }
-    std::vector<std::tr1::shared_ptr<Listing> > &getListings() { return listings; }
+    unsigned int getProduct() { return product; }
+    std::vector<unsigned int> &getListings() { return listings; }
     std::vector<float> &getWeights() { return weights; }
 
-    void setProduct(std::tr1::shared_ptr<Product> product_) { product = product_; }
+    void setProduct(unsigned int product_) { product = product_; }
 
-    void addListing(std::tr1::shared_ptr<Listing> listing) { listings.push_back(listing); }
+    void addListing(unsigned int listing) { listings.push_back(listing); }
     void addWeight(float weight) { weights.push_back(weight); }    
 
     void reserveListings(unsigned int size) { listings.reserve(size); }
     void reserveWeights(unsigned int size) { weights.reserve(size); }
 };//ResultHolder
 
+//Which fields of the listings and products are normalized as they're read in, as masks of
+//Listing::Field and Product::Field bits. The rest are only kept as raw text, with no tokens.
+struct FieldSet
+{
+    unsigned int listingFields;
+    unsigned int productFields;
+
+    FieldSet(unsigned int listingFields_ = ~0u, unsigned int productFields_ = ~0u)
+        : listingFields(listingFields_), productFields(productFields_)
+    {
+    }//constructor
+};//FieldSet
+
 //Holds all the listings, products, and results
 class Datas
 {
@@ -47,17 +64,51 @@ class Datas
     std::vector<std::tr1::shared_ptr<ResultHolder> > results;
 
 public:    
-    StringTable stringTable; //we don't need to have a lock around this
+    StringTable stringTable; //locks itself while strings are added, read only once frozen
+    NormalizeCache normalizeCache; //for the fields whose values repeat a lot, used while importing
+    FieldSet normalizedFields; //what the matcher reads, everything unless it says otherwise
+    ListingCorpus listingCorpus; //the listings laid out for matching, filled as they're added
+    MatchStates matchStates; //each listing's best match, the only thing the matching threads write
+
+    Datas() : normalizeCache(stringTable) {}
+
+    //Moves the listing's title and manufacturer tokens into listingCorpus
+    void addListing(std::tr1::shared_ptr<Listing> listing)
+    {
+        listingCorpus.addListing(*listing);
+        listings.push_back(listing);
+    }//addListing
 
-    void addListing(std::tr1::shared_ptr<Listing> listing) { listings.push_back(listing); }
     void addProduct(std::tr1::shared_ptr<Product> product) { products.push_back(product); }
     void addResult(std::tr1::shared_ptr<ResultHolder> result) { results.push_back(result); }
 
+    void reserveListings(unsigned int size)
+    {
+        listings.reserve(size);
+        listingCorpus.reserve(size);
+    }//reserveListings
+
+    void reserveProducts(unsigned int size) { products.reserve(size); }
+
     std::pair<std::vector<std::tr1::shared_ptr<Listing> >::iterator, std::vector<std::tr1::shared_ptr<Listing> >::iterator> getListingPair() 
     { 
         return std::make_pair(listings.begin(), listings.end()); 
     }//getListingPair
 
+    //Only the listings from firstListing on
+    std::pair<std::vector<std::tr1::shared_ptr<Listing> >::iterator, std::vector<std::tr1::shared_ptr<Listing> >::iterator> getListingPair(unsigned int firstListing) 
+    { 
+        return std::make_pair(listings.begin() + firstListing, listings.end()); 
+    }//getListingPair
+
+    unsigned int getNumListings() const { return listings.size(); }
+
+    const std::tr1::shared_ptr<Listing> &getListing(unsigned int index) const { return listings[index]; }
+
+    unsigned int getNumProducts() const { return products.size(); }
+
+    const std::tr1::shared_ptr<Product> &getProduct(unsigned int index) const { return products[index]; }
+
     std::pair<std::vector<std::tr1::shared_ptr<Product> >::iterator, std::vector<std::tr1::shared_ptr<Product> >::iterator> getProductPair() 
     { 
         return std::make_pair(products.begin(), products.end()); 
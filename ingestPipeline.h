@@ -0,0 +1,255 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __INGESTPIPELINE_H
+#define __INGESTPIPELINE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <tr1/memory>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <json/json.h>
+#include "boundedQueue.h"
+#include "mappedFile.h"
+
+//How many threads each stage of an ingest pipeline gets, and how much work may queue up between them
+struct IngestOptions
+{
+    unsigned int decodeThreads;
+    unsigned int normalizeThreads;
+    unsigned int queueCapacity;      //Batches waiting between two stages
+    unsigned int maxBatchesInFlight; //Batches read but not stored yet. Bounds memory when one batch is slow.
+    size_t batchSize;                //Bytes of input per batch, rounded up to a whole line
+
+    explicit IngestOptions(unsigned int numThreads)
+    {
+        numThreads = std::max(numThreads, 1u);
+
+        decodeThreads = numThreads;
+        normalizeThreads = numThreads;
+        queueCapacity = 2 * numThreads + 2;
+        maxBatchesInFlight = 4 * numThreads + 4;
+        batchSize = 64 * 1024;
+    }//constructor
+};//IngestOptions
+
+//Ingests a file holding a JSON record per line as stages which overlap, connected by bounded queues:
+//
+//  read (1 thread) -> decode (decodeThreads) -> normalize (normalizeThreads) -> store (calling thread)
+//
+//The read stage cuts the file into newline aligned batches and has the kernel start paging each one
+//in before it is queued. Batches can overtake each other in the middle stages; the store stage puts
+//them back in file order, so records get stored in the same order as reading the file line by line.
+template <class Record, class Decoder>
+class IngestPipeline
+{
+public:
+    typedef boost::function<void (Record &)> NormalizeFunction;
+    typedef boost::function<void (std::tr1::shared_ptr<Record>)> StoreFunction;
+
+private:
+    //A newline aligned piece of the file and the records decoded out of it
+    struct Batch
+    {
+        unsigned int sequence;
+        const char *batchBegin;
+        const char *batchEnd;
+
+        std::vector<std::tr1::shared_ptr<Record> > records;
+        std::string errorMessage; //Empty if the whole batch decoded
+    };//Batch
+
+    typedef std::tr1::shared_ptr<Batch> BatchPtr;
+
+    IngestOptions options;
+    NormalizeFunction normalize;
+    StoreFunction store;
+    std::string recordName; //For error messages, eg. "listing"
+
+    //Thread worker function.. cut [begin, end) into batches. Each batch takes a slot in inFlight,
+    //which the store stage gives back, so reading stops while too many batches are unfinished.
+    void readStage(const MappedFile &file, const char *begin, const char *end, BoundedQueue<BatchPtr> &readQueue, BoundedQueue<bool> &inFlight)
+    {
+        unsigned int sequence = 0;
+        const char *batchBegin = begin;
+        while (batchBegin < end) {
+            const char *batchEnd = end;
+
+            if ((size_t)(end - batchBegin) > options.batchSize) {
+                const char *newLine = static_cast<const char *>(memchr(batchBegin + options.batchSize, '\n', end - batchBegin - options.batchSize));
+                if (newLine != NULL) {
+                    batchEnd = newLine + 1;
+                }//if
+            }//if
+
+            if (inFlight.push(true) == false) {
+                break;
+            }//if
+
+            file.willNeed(batchBegin, batchEnd);
+
+            BatchPtr batch(new Batch);
+            batch->sequence = sequence++;
+            batch->batchBegin = batchBegin;
+            batch->batchEnd = batchEnd;
+            if (readQueue.push(batch) == false) {
+                break;
+            }//if
+
+            batchBegin = batchEnd;
+        }//while
+
+        readQueue.close();
+    }//readStage
+
+    //Decode every line of a batch, stopping at the first bad one
+    void decodeBatch(Batch &batch, Json::Reader &reader, Decoder &decoder)
+    {
+        const char *batchPos = batch.batchBegin;
+        const char *lineBegin;
+        const char *lineEnd;
+        while (nextLine(batchPos, batch.batchEnd, lineBegin, lineEnd)) {
+            if (lineBegin == lineEnd) {
+                continue;
+            }//if
+
+            std::tr1::shared_ptr<Record> newRecord(new Record);
+            bool parsingSuccessful = decoder.decode(reader, lineBegin, lineEnd, *newRecord);
+            if (false == parsingSuccessful) {
+                batch.errorMessage = "Failed to parse " + recordName + " configuration\n" + reader.getFormattedErrorMessages();
+                batch.errorMessage += "line was: '" + std::string(lineBegin, lineEnd) + "'";
+                return;
+            }//if
+
+            batch.records.push_back(newRecord);
+        }//while
+    }//decodeBatch
+
+    //Thread worker function.. decode batches until there are no more
+    void decodeStage(BoundedQueue<BatchPtr> &readQueue, BoundedQueue<BatchPtr> &decodedQueue)
+    {
+        Json::Reader reader;
+        Decoder decoder;
+
+        BatchPtr batch;
+        while (readQueue.pop(batch)) {
+            decodeBatch(*batch, reader, decoder);
+
+            if (decodedQueue.push(batch) == false) {
+                break;
+            }//if
+        }//while
+
+        decodedQueue.close();
+    }//decodeStage
+
+    //Thread worker function.. normalize the records of batches until there are no more
+    void normalizeStage(BoundedQueue<BatchPtr> &decodedQueue, BoundedQueue<BatchPtr> &normalizedQueue)
+    {
+        BatchPtr batch;
+        while (decodedQueue.pop(batch)) {
+            if (batch->errorMessage.empty() == true) {
+                BOOST_FOREACH (std::tr1::shared_ptr<Record> record, batch->records) {
+                    normalize(*record);
+                }//foreach
+            }//if
+
+            if (normalizedQueue.push(batch) == false) {
+                break;
+            }//if
+        }//while
+
+        normalizedQueue.close();
+    }//normalizeStage
+
+public:
+    IngestPipeline(const IngestOptions &options_, NormalizeFunction normalize_, StoreFunction store_, const std::string &recordName_)
+        : options(options_), normalize(normalize_), store(store_), recordName(recordName_)
+    {
+    }//constructor
+
+    //Ingest the lines in [begin, end) of file. On failure errorMessage says what was wrong with the first
+    //bad line, and only the batches before the one holding it have been stored.
+    bool run(const MappedFile &file, const char *begin, const char *end, std::string &errorMessage)
+    {
+        unsigned int decodeThreads = std::max(options.decodeThreads, 1u);
+        unsigned int normalizeThreads = std::max(options.normalizeThreads, 1u);
+
+        BoundedQueue<BatchPtr> readQueue(options.queueCapacity, 1);
+        BoundedQueue<BatchPtr> decodedQueue(options.queueCapacity, decodeThreads);
+        BoundedQueue<BatchPtr> normalizedQueue(options.queueCapacity, normalizeThreads);
+        BoundedQueue<bool> inFlight(std::max(options.maxBatchesInFlight, 1u), 1);
+
+        std::vector<std::tr1::shared_ptr<boost::thread> > threadPool;
+        threadPool.push_back(std::tr1::shared_ptr<boost::thread>(new boost::thread(
+                boost::bind(&IngestPipeline::readStage, this, boost::cref(file), begin, end, boost::ref(readQueue), boost::ref(inFlight)))));
+
+        for (unsigned int thread = 0; thread < decodeThreads; ++thread) {
+            threadPool.push_back(std::tr1::shared_ptr<boost::thread>(new boost::thread(
+                    boost::bind(&IngestPipeline::decodeStage, this, boost::ref(readQueue), boost::ref(decodedQueue)))));
+        }//for
+
+        for (unsigned int thread = 0; thread < normalizeThreads; ++thread) {
+            threadPool.push_back(std::tr1::shared_ptr<boost::thread>(new boost::thread(
+                    boost::bind(&IngestPipeline::normalizeStage, this, boost::ref(decodedQueue), boost::ref(normalizedQueue)))));
+        }//for
+
+        //Store stage. Batches which arrive early wait in pending until the ones before them are stored.
+        std::map<unsigned int, BatchPtr> pending;
+        unsigned int nextSequence = 0;
+        bool successful = true;
+
+        BatchPtr batch;
+        while ((true == successful) && normalizedQueue.pop(batch)) {
+            pending[batch->sequence] = batch;
+
+            typename std::map<unsigned int, BatchPtr>::iterator pendingIter;
+            while ((true == successful) && ((pendingIter = pending.find(nextSequence)) != pending.end())) {
+                BatchPtr nextBatch = pendingIter->second;
+                pending.erase(pendingIter);
+
+                if (nextBatch->errorMessage.empty() == false) {
+                    errorMessage = nextBatch->errorMessage;
+                    successful = false;
+                    break;
+                }//if
+
+                BOOST_FOREACH (std::tr1::shared_ptr<Record> record, nextBatch->records) {
+                    store(record);
+                }//foreach
+
+                ++nextSequence;
+
+                bool slot;
+                inFlight.pop(slot);
+            }//while
+        }//while
+
+        //Stop the other stages short
+        if (false == successful) {
+            inFlight.abort();
+            readQueue.abort();
+            decodedQueue.abort();
+            normalizedQueue.abort();
+        }//if
+
+        BOOST_FOREACH (std::tr1::shared_ptr<boost::thread> thread, threadPool) {
+            thread->join();
+        }//foreach
+
+        return successful;
+    }//run
+};//IngestPipeline
+
+#endif
+
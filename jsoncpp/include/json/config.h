@@ -24,6 +24,10 @@
 /// Only has effects if JSON_VALUE_USE_INTERNAL_MAP is defined.
 //#  define JSON_USE_SIMPLE_INTERNAL_ALLOCATOR 1
 
+/// If defined, the Reader scans whitespace and strings one character at a time
+/// instead of using SSE2/AVX2 (x86 only, AVX2 is selected at run time).
+//#  define JSON_NO_SIMD_SCAN 1
+
 /// If defined, indicates that Json use exception to report invalid type manipulation
 /// instead of C assert macro.
 # define JSON_USE_EXCEPTION 1
@@ -18,6 +18,7 @@ namespace Json {
 
    // reader.h
    class Reader;
+   class ReaderHandler;
 
    // features.h
    class Features;
@@ -25,9 +26,11 @@ namespace Json {
    // value.h
    typedef unsigned int ArrayIndex;
    class StaticString;
+   class BorrowedString;
    class Path;
    class PathArgument;
    class Value;
+   class ValueArena;
    class ValueIteratorBase;
    class ValueIterator;
    class ValueConstIterator;
@@ -10,13 +10,54 @@
 # include "features.h"
 # include "value.h"
 #endif // if !defined(JSON_IS_AMALGAMATION)
-# include <deque>
+# include <vector>
 # include <stack>
 # include <string>
 # include <iostream>
 
 namespace Json {
 
+   /** \brief Receives the events of a streamed parse.
+    *
+    * Used with Reader::parse( const char *, const char *, ReaderHandler & ) to pull
+    * values straight out of a document without building a Value tree.
+    *
+    * Keys and strings are passed as a [begin,end) range of decoded UTF-8 text. When the
+    * string contains no escape sequence the range points directly into the document,
+    * otherwise into a buffer owned by the Reader. Either way it is only valid for the
+    * duration of the call. Numbers are passed as the raw token text.
+    *
+    * Every callback returns \c true to continue, or \c false to abort the parse. The
+    * default implementations ignore the event.
+    *
+    * Calling skipValue() from key() makes the Reader step over that member's value
+    * without decoding it or delivering any events for it.
+    */
+   class JSON_API ReaderHandler
+   {
+   public:
+      ReaderHandler();
+      virtual ~ReaderHandler();
+
+      virtual bool startObject();
+      virtual bool key( const char *begin, const char *end );
+      virtual bool endObject();
+      virtual bool startArray();
+      virtual bool endArray();
+      virtual bool string( const char *begin, const char *end );
+      virtual bool number( const char *begin, const char *end );
+      virtual bool boolean( bool value );
+      virtual bool null();
+
+   protected:
+      /// Skip the value of the member whose key is being reported. Only meaningful from key().
+      void skipValue() { skipValue_ = true; }
+
+   private:
+      friend class Reader;
+      bool skipValue_;
+   };
+
    /** \brief Unserialize a <a HREF="http://www.json.org">JSON</a> document into a Value.
     *
     */
@@ -66,12 +107,55 @@ namespace Json {
                   Value &root,
                   bool collectComments = true );
 
+      /** \brief Stream a <a HREF="http://www.json.org">JSON</a> document to a handler
+       *         without building a Value tree.
+       * \param beginDoc Pointer on the beginning of the UTF-8 encoded string of the document to read.
+       * \param endDoc Pointer on the end of the UTF-8 encoded string of the document to read. 
+       \               Must be >= beginDoc.
+       * \param handler Receives one event per value, object and array boundary, and key.
+       *                Comments are skipped.
+       * \return \c true if the document was successfully parsed, \c false if an error occurred
+       *         or the handler aborted the parse. Events already delivered are not undone.
+       */
+      bool parse( const char *beginDoc, const char *endDoc, 
+                  ReaderHandler &handler );
+
       /// \brief Parse from input stream.
       /// \see Json::operator>>(std::istream&, Json::Value&).
       bool parse( std::istream &is,
                   Value &root,
                   bool collectComments = true );
 
+      /** \brief Forget the previous document so the Reader can be used for the next one.
+       *
+       * The error list, node stack and string buffers keep their memory, so a single
+       * Reader parsing many small documents (one per line, say) doesn't allocate
+       * per document. parse() calls this itself; it is only needed to drop
+       * references into a document that is about to go away.
+       */
+      void reset();
+
+      /** \brief Build the trees of parse( ..., Value &root, ... ) in \c arena.
+       *
+       * Nodes and strings of each document then come from the arena rather than the
+       * heap. Since a tree can't outlive its arena, parse() clears \c root and
+       * resets the arena before reading the next document: only one tree parsed
+       * this way is alive at a time. Copy a value to keep it. Pass 0 to go back
+       * to heap allocated trees.
+       */
+      void setValueArena( ValueArena *arena );
+
+      /** \brief Make string values of parse( ..., Value &root, ... ) reference the document.
+       *
+       * Strings without escape sequences then become BorrowedString values pointing
+       * into the parsed buffer instead of being copied, so the tree must not outlive
+       * the buffer. For parse( const std::string &, ... ) and parse( std::istream &, ... )
+       * that buffer is the Reader's own copy of the document, which lasts until the
+       * next parse. Strings with escapes, and member names, are still decoded into
+       * memory of their own.
+       */
+      void setBorrowStrings( bool borrow );
+
       /** \brief Returns a user friendly string that list errors in the parsed document.
        * \return Formatted error message with the list of errors with their location in 
        *         the parsed document. An empty string is returned if no error occurred
@@ -113,6 +197,7 @@ namespace Json {
          TokenType type_;
          Location start_;
          Location end_;
+         bool hasEscape_; // tokenString only: an escape sequence needs decoding
       };
 
       class ErrorInfo
@@ -123,7 +208,7 @@ namespace Json {
          Location extra_;
       };
 
-      typedef std::deque<ErrorInfo> Errors;
+      typedef std::vector<ErrorInfo> Errors;
 
       bool expectToken( TokenType type, Token &token, const char *message );
       bool readToken( Token &token );
@@ -133,11 +218,17 @@ namespace Json {
       bool readComment();
       bool readCStyleComment();
       bool readCppStyleComment();
-      bool readString();
+      bool readString( bool &hasEscape );
       void readNumber();
       bool readValue();
       bool readObject( Token &token );
       bool readArray( Token &token );
+      bool readValueEvents();
+      bool readObjectEvents( Token &token );
+      bool readArrayEvents( Token &token );
+      bool decodeStringEvent( Token &token, bool isKey );
+      bool skipValueTokens();
+      bool handlerResult( bool handlerOk, Token &token );
       bool decodeNumber( Token &token );
       bool decodeString( Token &token );
       bool decodeString( Token &token, std::string &decoded );
@@ -158,6 +249,7 @@ namespace Json {
                                Token &token,
                                TokenType skipUntilToken );
       void skipUntilSpace();
+      void setCurrentValue( ValueType type );
       Value &currentValue();
       Char getNextChar();
       void getLocationLineAndColumn( Location location,
@@ -169,7 +261,7 @@ namespace Json {
                        CommentPlacement placement );
       void skipCommentTokens( Token &token );
    
-      typedef std::stack<Value *> Nodes;
+      typedef std::stack<Value *, std::vector<Value *> > Nodes;
       Nodes nodes_;
       Errors errors_;
       std::string document_;
@@ -181,6 +273,10 @@ namespace Json {
       std::string commentsBefore_;
       Features features_;
       bool collectComments_;
+      ReaderHandler *handler_;
+      ValueArena *arena_;
+      bool borrowStrings_;
+      std::string decodedString_;
    };
 
    /** \brief Read from 'sin' into 'root'.
@@ -11,6 +11,8 @@
 #endif // if !defined(JSON_IS_AMALGAMATION)
 # include <string>
 # include <vector>
+# include <new>
+# include <cstddef>
 
 # ifndef JSON_USE_CPPTL_SMALLMAP
 #  include <map>
@@ -88,6 +90,184 @@ namespace Json {
       const char *str_;
    };
 
+   /** \brief Lightweight wrapper to tag a string that lives in a buffer owned by the caller.
+    *
+    * A Value built from a BorrowedString points at [begin,end) instead of copying it,
+    * so it is only valid as long as that buffer. Copies of the Value own their string.
+    * The range doesn't have to be zero terminated, so asCString() can't be used on
+    * such a value: use asString() or getString().
+    *
+    * Reader::setBorrowStrings() makes the Reader build string values this way.
+    */
+   class JSON_API BorrowedString
+   {
+   public:
+      BorrowedString( const char *begin, const char *end )
+         : begin_( begin )
+         , end_( end )
+      {
+      }
+
+      const char *begin() const
+      {
+         return begin_;
+      }
+
+      const char *end() const
+      {
+         return end_;
+      }
+
+   private:
+      const char *begin_;
+      const char *end_;
+   };
+
+   /** \brief Bump allocator for the nodes and strings of one parsed document.
+    *
+    * When a Reader is given an arena (see Reader::setValueArena()), every string,
+    * member name and object/array node of the parsed tree is carved out of the
+    * arena's pages instead of coming from malloc, and freeing them is a no-op.
+    * reset() hands all of it back at once by rewinding to the first page; the
+    * pages themselves are kept for the next document.
+    *
+    * Trees built in an arena must be destroyed (or assigned a new value) before
+    * the arena is reset or destroyed. Copying such a Value always produces an
+    * independent heap allocated tree.
+    */
+   class JSON_API ValueArena
+   {
+   public:
+      ValueArena( unsigned int pageSize = 64*1024 );
+      ~ValueArena();
+
+      /// Returns size bytes, suitably aligned for any Value node.
+      void *allocate( size_t size );
+
+      /// Copies [value, value+length) into the arena and zero terminates it.
+      char *duplicateString( const char *value, 
+                             unsigned int length );
+
+      /// Releases everything allocated so far. O(1) unless allocations larger
+      /// than a page were made, which are returned to the heap.
+      void reset();
+
+   private:
+      struct Page
+      {
+         Page *next_;
+         size_t size_;
+      };
+
+      // disabled copy constructor and assignement operator.
+      ValueArena( const ValueArena & );
+      void operator =( const ValueArena & );
+
+      char *pageData( Page *page ) const;
+      void *allocateSlow( size_t size );
+
+      Page *pages_;
+      Page *currentPage_;
+      Page *largeAllocations_;
+      char *current_;
+      char *end_;
+      unsigned int pageSize_;
+   };
+
+
+   /** \brief STL allocator for the object/array nodes of a Value.
+    *
+    * Allocates from a ValueArena when it has one, and from the heap otherwise.
+    */
+   template<typename T>
+   class ValueArenaAllocator
+   {
+   public:
+      typedef T value_type;
+      typedef T *pointer;
+      typedef const T *const_pointer;
+      typedef T &reference;
+      typedef const T &const_reference;
+      typedef size_t size_type;
+      typedef ptrdiff_t difference_type;
+
+      template<typename U>
+      struct rebind
+      {
+         typedef ValueArenaAllocator<U> other;
+      };
+
+      ValueArenaAllocator( ValueArena *arena = 0 )
+         : arena_( arena )
+      {
+      }
+
+      template<typename U>
+      ValueArenaAllocator( const ValueArenaAllocator<U> &other )
+         : arena_( other.arena() )
+      {
+      }
+
+      pointer allocate( size_type count, const void * = 0 )
+      {
+         if ( arena_ )
+            return static_cast<pointer>( arena_->allocate( count * sizeof(T) ) );
+         return static_cast<pointer>( ::operator new( count * sizeof(T) ) );
+      }
+
+      void deallocate( pointer p, size_type )
+      {
+         if ( !arena_ )
+            ::operator delete( p );
+      }
+
+      void construct( pointer p, const T &value )
+      {
+         new (p) T( value );
+      }
+
+      void destroy( pointer p )
+      {
+         p->~T();
+      }
+
+      pointer address( reference value ) const
+      {
+         return &value;
+      }
+
+      const_pointer address( const_reference value ) const
+      {
+         return &value;
+      }
+
+      size_type max_size() const
+      {
+         return size_type(-1) / sizeof(T);
+      }
+
+      ValueArena *arena() const
+      {
+         return arena_;
+      }
+
+      template<typename U>
+      bool operator ==( const ValueArenaAllocator<U> &other ) const
+      {
+         return arena_ == other.arena();
+      }
+
+      template<typename U>
+      bool operator !=( const ValueArenaAllocator<U> &other ) const
+      {
+         return arena_ != other.arena();
+      }
+
+   private:
+      ValueArena *arena_;
+   };
+
+
    /** \brief Represents a <a HREF="http://www.json.org">JSON</a> value.
     *
     * This class is a discriminated union wrapper that can represents a:
@@ -168,7 +348,8 @@ namespace Json {
          {
             noDuplication = 0,
             duplicate,
-            duplicateOnCopy
+            duplicateOnCopy,
+            inArena         ///< Lives in a ValueArena: never released, shared by copies within the arena tree
          };
          CZString( ArrayIndex index );
          CZString( const char *cstr, DuplicationPolicy allocate );
@@ -180,6 +361,7 @@ namespace Json {
          ArrayIndex index() const;
          const char *c_str() const;
          bool isStaticString() const;
+         bool isInArena() const;
       private:
          void swap( CZString &other );
          const char *cstr_;
@@ -188,7 +370,8 @@ namespace Json {
 
    public:
 #  ifndef JSON_USE_CPPTL_SMALLMAP
-      typedef std::map<CZString, Value> ObjectValues;
+      typedef std::map<CZString, Value, std::less<CZString>, 
+                       ValueArenaAllocator<std::pair<const CZString, Value> > > ObjectValues;
 #  else
       typedef CppTL::SmallMap<CZString, Value> ObjectValues;
 #  endif // ifndef JSON_USE_CPPTL_SMALLMAP
@@ -221,6 +404,10 @@ namespace Json {
       Value( double value );
       Value( const char *value );
       Value( const char *beginValue, const char *endValue );
+      /// Like Value( ValueType ), but an object or array keeps its nodes in \c arena.
+      Value( ValueType type, ValueArena &arena );
+      /// Like Value( const char *, const char * ), but the string is copied into \c arena.
+      Value( const char *beginValue, const char *endValue, ValueArena &arena );
       /** \brief Constructs a value from a static string.
 
        * Like other value string constructor but do not duplicate the string for
@@ -232,6 +419,10 @@ namespace Json {
        * \endcode
        */
       Value( const StaticString &value );
+      /** \brief Constructs a value referencing a string owned by the caller, without copying it.
+       * \see BorrowedString
+       */
+      Value( const BorrowedString &value );
       Value( const std::string &value );
 # ifdef JSON_USE_CPPTL
       Value( const CppTL::ConstString &value );
@@ -260,6 +451,12 @@ namespace Json {
 
       const char *asCString() const;
       std::string asString() const;
+      /** \brief Get the raw characters of a string value, without copying them.
+       * \return \c false if the value is not a string.
+       */
+      bool getString( const char **begin, const char **end ) const;
+      /// \c true if the string references a buffer owned by the caller (see BorrowedString).
+      bool isBorrowedString() const;
 # ifdef JSON_USE_CPPTL
       CppTL::ConstString asConstString() const;
 # endif
@@ -363,6 +560,12 @@ namespace Json {
        * \endcode
        */
       Value &operator[]( const StaticString &key );
+      /** \brief Access an object value by name, create a null member in \c arena if it does not exist.
+       *
+       * Used by Reader to build a tree in a ValueArena. If the value is null, it
+       * becomes an object whose nodes live in \c arena as well.
+       */
+      Value &resolveMember( const char *key, ValueArena &arena );
 # ifdef JSON_USE_CPPTL
       /// Access an object value by name, create a null member if it does not exist.
       Value &operator[]( const CppTL::ConstString &key );
@@ -491,10 +694,13 @@ namespace Json {
       } value_;
       ValueType type_ : 8;
       int allocated_ : 1;     // Notes: if declared as bool, bitfield is useless.
+      unsigned int inArena_ : 1; // object/array: map_ was placed in a ValueArena
+      unsigned int borrowed_ : 1; // string: string_ points into the caller's buffer, stringLength_ long
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
       unsigned int itemIsUsed_ : 1;      // used by the ValueInternalMap container.
       int memberNameIsStatic_ : 1;       // used by the ValueInternalMap container.
 # endif
+      unsigned int stringLength_;   // Notes: fits in the padding before comments_
       CommentInfo *comments_;
    };
 
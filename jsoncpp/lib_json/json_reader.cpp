@@ -7,6 +7,7 @@
 # include <json/reader.h>
 # include <json/value.h>
 # include "json_tool.h"
+# include "json_scan.h"
 #endif // if !defined(JSON_IS_AMALGAMATION)
 #include <utility>
 #include <cstdio>
@@ -75,17 +76,112 @@ containsNewLine( Reader::Location begin,
 }
 
 
+// Class ReaderHandler
+// //////////////////////////////////////////////////////////////////
+
+ReaderHandler::ReaderHandler()
+   : skipValue_( false )
+{
+}
+
+
+ReaderHandler::~ReaderHandler()
+{
+}
+
+
+bool 
+ReaderHandler::startObject()
+{
+   return true;
+}
+
+
+bool 
+ReaderHandler::key( const char * /*begin*/, const char * /*end*/ )
+{
+   return true;
+}
+
+
+bool 
+ReaderHandler::endObject()
+{
+   return true;
+}
+
+
+bool 
+ReaderHandler::startArray()
+{
+   return true;
+}
+
+
+bool 
+ReaderHandler::endArray()
+{
+   return true;
+}
+
+
+bool 
+ReaderHandler::string( const char * /*begin*/, const char * /*end*/ )
+{
+   return true;
+}
+
+
+bool 
+ReaderHandler::number( const char * /*begin*/, const char * /*end*/ )
+{
+   return true;
+}
+
+
+bool 
+ReaderHandler::boolean( bool /*value*/ )
+{
+   return true;
+}
+
+
+bool 
+ReaderHandler::null()
+{
+   return true;
+}
+
+
 // Class Reader
 // //////////////////////////////////////////////////////////////////
 
 Reader::Reader()
-   : features_( Features::all() )
+   : begin_( 0 )
+   , end_( 0 )
+   , current_( 0 )
+   , lastValueEnd_( 0 )
+   , lastValue_( 0 )
+   , features_( Features::all() )
+   , collectComments_( false )
+   , handler_( 0 )
+   , arena_( 0 )
+   , borrowStrings_( false )
 {
 }
 
 
 Reader::Reader( const Features &features )
-   : features_( features )
+   : begin_( 0 )
+   , end_( 0 )
+   , current_( 0 )
+   , lastValueEnd_( 0 )
+   , lastValue_( 0 )
+   , features_( features )
+   , collectComments_( false )
+   , handler_( 0 )
+   , arena_( 0 )
+   , borrowStrings_( false )
 {
 }
 
@@ -129,16 +225,20 @@ Reader::parse( const char *beginDoc, const char *endDoc,
       collectComments = false;
    }
 
+   reset();
+   if ( arena_ )
+   {
+      // The previous tree may live in the arena: drop it before reusing its memory.
+      {
+         Value empty;
+         root.swap( empty );
+      }
+      arena_->reset();
+   }
    begin_ = beginDoc;
    end_ = endDoc;
    collectComments_ = collectComments;
    current_ = begin_;
-   lastValueEnd_ = 0;
-   lastValue_ = 0;
-   commentsBefore_ = "";
-   errors_.clear();
-   while ( !nodes_.empty() )
-      nodes_.pop();
    nodes_.push( &root );
    
    bool successful = readValue();
@@ -163,6 +263,70 @@ Reader::parse( const char *beginDoc, const char *endDoc,
 }
 
 
+bool 
+Reader::parse( const char *beginDoc, const char *endDoc, 
+               ReaderHandler &handler )
+{
+   reset();
+   begin_ = beginDoc;
+   end_ = endDoc;
+   collectComments_ = false;
+   current_ = begin_;
+   handler_ = &handler;
+
+   if ( features_.strictRoot_ )
+   {
+      Location rootStart = current_;
+      Token token;
+      skipCommentTokens( token );
+      current_ = rootStart;
+      if ( token.type_ != tokenObjectBegin  &&  token.type_ != tokenArrayBegin )
+      {
+         token.type_ = tokenError;
+         token.start_ = beginDoc;
+         token.end_ = endDoc;
+         handler_ = 0;
+         return addError( "A valid JSON document must be either an array or an object value.",
+                          token );
+      }
+   }
+
+   bool successful = readValueEvents();
+   handler_ = 0;
+   return successful;
+}
+
+
+void 
+Reader::reset()
+{
+   begin_ = 0;
+   end_ = 0;
+   current_ = 0;
+   lastValueEnd_ = 0;
+   lastValue_ = 0;
+   commentsBefore_.clear();
+   errors_.clear();
+   while ( !nodes_.empty() )
+      nodes_.pop();
+   handler_ = 0;
+}
+
+
+void 
+Reader::setValueArena( ValueArena *arena )
+{
+   arena_ = arena;
+}
+
+
+void 
+Reader::setBorrowStrings( bool borrow )
+{
+   borrowStrings_ = borrow;
+}
+
+
 bool
 Reader::readValue()
 {
@@ -265,7 +429,7 @@ Reader::readToken( Token &token )
       break;
    case '"':
       token.type_ = tokenString;
-      ok = readString();
+      ok = readString( token.hasEscape_ );
       break;
    case '/':
       token.type_ = tokenComment;
@@ -320,14 +484,7 @@ Reader::readToken( Token &token )
 void 
 Reader::skipSpaces()
 {
-   while ( current_ != end_ )
-   {
-      Char c = *current_;
-      if ( c == ' '  ||  c == '\t'  ||  c == '\r'  ||  c == '\n' )
-         ++current_;
-      else
-         break;
-   }
+   current_ = findNonSpace( current_, end_ );
 }
 
 
@@ -433,18 +590,23 @@ Reader::readNumber()
 }
 
 bool
-Reader::readString()
+Reader::readString( bool &hasEscape )
 {
-   Char c = 0;
-   while ( current_ != end_ )
+   // Jump straight to the next quote or backslash. A string without
+   // escapes is found in a single scan.
+   hasEscape = false;
+   for (;;)
    {
-      c = getNextChar();
-      if ( c == '\\' )
-         getNextChar();
-      else if ( c == '"' )
-         break;
+      current_ = findStringSpecial( current_, end_ );
+      if ( current_ == end_ )
+         return false;
+      if ( *current_++ == '"' )
+         return true;
+      hasEscape = true;
+      if ( current_ == end_ )
+         return false;
+      ++current_; // escaped character
    }
-   return c == '"';
 }
 
 
@@ -453,7 +615,7 @@ Reader::readObject( Token &/*tokenStart*/ )
 {
    Token tokenName;
    std::string name;
-   currentValue() = Value( objectValue );
+   setCurrentValue( objectValue );
    while ( readToken( tokenName ) )
    {
       bool initialTokenOk = true;
@@ -467,7 +629,9 @@ Reader::readObject( Token &/*tokenStart*/ )
          break;
       
       name = "";
-      if ( !decodeString( tokenName, name ) )
+      if ( !tokenName.hasEscape_ )
+         name.assign( tokenName.start_ + 1, tokenName.end_ - 1 );
+      else if ( !decodeString( tokenName, name ) )
          return recoverFromError( tokenObjectEnd );
 
       Token colon;
@@ -477,7 +641,8 @@ Reader::readObject( Token &/*tokenStart*/ )
                                     colon, 
                                     tokenObjectEnd );
       }
-      Value &value = currentValue()[ name ];
+      Value &value = arena_ ? currentValue().resolveMember( name.c_str(), *arena_ )
+                            : currentValue()[ name ];
       nodes_.push( &value );
       bool ok = readValue();
       nodes_.pop();
@@ -510,7 +675,7 @@ Reader::readObject( Token &/*tokenStart*/ )
 bool 
 Reader::readArray( Token &/*tokenStart*/ )
 {
-   currentValue() = Value( arrayValue );
+   setCurrentValue( arrayValue );
    skipSpaces();
    if ( *current_ == ']' ) // empty array
    {
@@ -550,6 +715,198 @@ Reader::readArray( Token &/*tokenStart*/ )
 }
 
 
+bool 
+Reader::readValueEvents()
+{
+   Token token;
+   skipCommentTokens( token );
+
+   switch ( token.type_ )
+   {
+   case tokenObjectBegin:
+      return readObjectEvents( token );
+   case tokenArrayBegin:
+      return readArrayEvents( token );
+   case tokenNumber:
+      return handlerResult( handler_->number( token.start_, token.end_ ), token );
+   case tokenString:
+      return decodeStringEvent( token, false );
+   case tokenTrue:
+      return handlerResult( handler_->boolean( true ), token );
+   case tokenFalse:
+      return handlerResult( handler_->boolean( false ), token );
+   case tokenNull:
+      return handlerResult( handler_->null(), token );
+   default:
+      return addError( "Syntax error: value, object or array expected.", token );
+   }
+}
+
+
+bool 
+Reader::readObjectEvents( Token &tokenStart )
+{
+   if ( !handlerResult( handler_->startObject(), tokenStart ) )
+      return false;
+   Token tokenName;
+   bool isEmpty = true;
+   while ( readToken( tokenName ) )
+   {
+      bool initialTokenOk = true;
+      while ( tokenName.type_ == tokenComment  &&  initialTokenOk )
+         initialTokenOk = readToken( tokenName );
+      if  ( !initialTokenOk )
+         break;
+      if ( tokenName.type_ == tokenObjectEnd  &&  isEmpty )  // empty object
+         return handlerResult( handler_->endObject(), tokenName );
+      if ( tokenName.type_ != tokenString )
+         break;
+      isEmpty = false;
+
+      handler_->skipValue_ = false;
+      if ( !decodeStringEvent( tokenName, true ) )
+         return false;
+
+      Token colon;
+      if ( !readToken( colon ) ||  colon.type_ != tokenMemberSeparator )
+         return addError( "Missing ':' after object member name", colon );
+      if ( handler_->skipValue_ )
+      {
+         handler_->skipValue_ = false;
+         if ( !skipValueTokens() ) // error already set
+            return false;
+      }
+      else if ( !readValueEvents() ) // error already set
+         return false;
+
+      Token comma;
+      if ( !readToken( comma )
+            ||  ( comma.type_ != tokenObjectEnd  &&  
+                  comma.type_ != tokenArraySeparator &&
+                  comma.type_ != tokenComment ) )
+      {
+         return addError( "Missing ',' or '}' in object declaration", comma );
+      }
+      bool finalizeTokenOk = true;
+      while ( comma.type_ == tokenComment &&
+              finalizeTokenOk )
+         finalizeTokenOk = readToken( comma );
+      if ( comma.type_ == tokenObjectEnd )
+         return handlerResult( handler_->endObject(), comma );
+   }
+   return addError( "Missing '}' or object member name", tokenName );
+}
+
+
+bool 
+Reader::readArrayEvents( Token &tokenStart )
+{
+   if ( !handlerResult( handler_->startArray(), tokenStart ) )
+      return false;
+   skipSpaces();
+   if ( current_ != end_  &&  *current_ == ']' ) // empty array
+   {
+      Token endArray;
+      readToken( endArray );
+      return handlerResult( handler_->endArray(), endArray );
+   }
+   for (;;)
+   {
+      if ( !readValueEvents() ) // error already set
+         return false;
+
+      Token token;
+      // Accept Comment after last item in the array.
+      bool ok = readToken( token );
+      while ( token.type_ == tokenComment  &&  ok )
+      {
+         ok = readToken( token );
+      }
+      bool badTokenType = ( token.type_ != tokenArraySeparator  &&
+                            token.type_ != tokenArrayEnd );
+      if ( !ok  ||  badTokenType )
+         return addError( "Missing ',' or ']' in array declaration", token );
+      if ( token.type_ == tokenArrayEnd )
+         return handlerResult( handler_->endArray(), token );
+   }
+}
+
+
+bool 
+Reader::decodeStringEvent( Token &token, bool isKey )
+{
+   Location begin = token.start_ + 1; // skip '"'
+   Location end = token.end_ - 1;     // do not include '"'
+   if ( token.hasEscape_ )
+   {
+      decodedString_.clear();
+      if ( !decodeString( token, decodedString_ ) )
+         return false;
+      begin = decodedString_.data();
+      end = begin + decodedString_.length();
+   }
+   if ( isKey )
+      return handlerResult( handler_->key( begin, end ), token );
+   return handlerResult( handler_->string( begin, end ), token );
+}
+
+
+// Steps over one value without decoding anything. Nested objects and arrays
+// are only checked for balanced brackets.
+bool 
+Reader::skipValueTokens()
+{
+   Token token;
+   skipCommentTokens( token );
+   switch ( token.type_ )
+   {
+   case tokenString:
+   case tokenNumber:
+   case tokenTrue:
+   case tokenFalse:
+   case tokenNull:
+      return true;
+   case tokenObjectBegin:
+   case tokenArrayBegin:
+      break;
+   default:
+      return addError( "Syntax error: value, object or array expected.", token );
+   }
+
+   int depth = 1;
+   while ( depth > 0 )
+   {
+      readToken( token );
+      switch ( token.type_ )
+      {
+      case tokenObjectBegin:
+      case tokenArrayBegin:
+         ++depth;
+         break;
+      case tokenObjectEnd:
+      case tokenArrayEnd:
+         --depth;
+         break;
+      case tokenError:
+      case tokenEndOfStream:
+         return addError( "Missing '}' or ']' in skipped value", token );
+      default:
+         break;
+      }
+   }
+   return true;
+}
+
+
+bool 
+Reader::handlerResult( bool handlerOk, Token &token )
+{
+   if ( !handlerOk )
+      return addError( "Parse aborted by handler.", token );
+   return true;
+}
+
+
 bool 
 Reader::decodeNumber( Token &token )
 {
@@ -633,10 +990,24 @@ Reader::decodeDouble( Token &token )
 bool 
 Reader::decodeString( Token &token )
 {
-   std::string decoded;
-   if ( !decodeString( token, decoded ) )
-      return false;
-   currentValue() = decoded;
+   const char *begin = token.start_ + 1;
+   const char *end = token.end_ - 1;
+   if ( !token.hasEscape_  &&  borrowStrings_ )
+   {
+      Value borrowed( BorrowedString( begin, end ) );
+      currentValue().swap( borrowed );
+      return true;
+   }
+   if ( token.hasEscape_ )
+   {
+      decodedString_.clear();
+      if ( !decodeString( token, decodedString_ ) )
+         return false;
+      begin = decodedString_.data();
+      end = begin + decodedString_.length();
+   }
+   Value decoded = arena_ ? Value( begin, end, *arena_ ) : Value( begin, end );
+   currentValue().swap( decoded );
    return true;
 }
 
@@ -784,6 +1155,15 @@ Reader::addErrorAndRecover( const std::string &message,
 }
 
 
+void 
+Reader::setCurrentValue( ValueType type )
+{
+   // Swapping in the new value saves copying it as operator= would.
+   Value value = arena_ ? Value( type, *arena_ ) : Value( type );
+   currentValue().swap( value );
+}
+
+
 Value &
 Reader::currentValue()
 {
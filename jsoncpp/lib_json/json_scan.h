@@ -0,0 +1,191 @@
+// Copyright 2007-2010 Baptiste Lepilleur
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef LIB_JSONCPP_JSON_SCAN_H_INCLUDED
+# define LIB_JSONCPP_JSON_SCAN_H_INCLUDED
+
+/* This header provides the character scanning loops used by the Reader:
+ * skipping whitespace and finding the next quote or backslash in a string.
+ *
+ * On x86 they look at 16 (SSE2) or 32 (AVX2) bytes at a time. AVX2 is picked at
+ * run time if the CPU has it. Define JSON_NO_SIMD_SCAN to always use the plain loops.
+ *
+ * It is an internal header that must not be exposed.
+ */
+
+#if !defined(JSON_NO_SIMD_SCAN)  &&  defined(__GNUC__)  &&  ( defined(__x86_64__)  ||  defined(__SSE2__) )
+# define JSON_SIMD_SCAN 1
+# include <emmintrin.h>
+# if __GNUC__ > 4  ||  ( __GNUC__ == 4  &&  __GNUC_MINOR__ >= 9 )
+#  define JSON_SIMD_SCAN_AVX2 1
+#  include <immintrin.h>
+# endif
+#endif
+
+namespace Json {
+
+static inline bool
+isJsonSpace( char c )
+{
+   return c == ' '  ||  c == '\t'  ||  c == '\r'  ||  c == '\n';
+}
+
+
+/// Returns the first character in [current,end[ that is not whitespace, or end.
+static inline const char *
+findNonSpaceScalar( const char *current, const char *end )
+{
+   while ( current != end  &&  isJsonSpace( *current ) )
+      ++current;
+   return current;
+}
+
+
+/// Returns the first '"' or '\\' in [current,end[, or end.
+static inline const char *
+findStringSpecialScalar( const char *current, const char *end )
+{
+   while ( current != end  &&  *current != '"'  &&  *current != '\\' )
+      ++current;
+   return current;
+}
+
+
+#ifdef JSON_SIMD_SCAN
+
+static inline __m128i
+spaceMask16( __m128i chunk )
+{
+   return _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, _mm_set1_epi8( ' ' ) ),
+                                      _mm_cmpeq_epi8( chunk, _mm_set1_epi8( '\t' ) ) ),
+                        _mm_or_si128( _mm_cmpeq_epi8( chunk, _mm_set1_epi8( '\r' ) ),
+                                      _mm_cmpeq_epi8( chunk, _mm_set1_epi8( '\n' ) ) ) );
+}
+
+
+static inline const char *
+findNonSpaceSSE2( const char *current, const char *end )
+{
+   while ( end - current >= 16 )
+   {
+      __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i *>( current ) );
+      unsigned int notSpace = ~unsigned( _mm_movemask_epi8( spaceMask16( chunk ) ) ) & 0xffff;
+      if ( notSpace )
+         return current + __builtin_ctz( notSpace );
+      current += 16;
+   }
+   return findNonSpaceScalar( current, end );
+}
+
+
+static inline const char *
+findStringSpecialSSE2( const char *current, const char *end )
+{
+   const __m128i quote = _mm_set1_epi8( '"' );
+   const __m128i backslash = _mm_set1_epi8( '\\' );
+   while ( end - current >= 16 )
+   {
+      __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i *>( current ) );
+      unsigned int special = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ),
+                                                              _mm_cmpeq_epi8( chunk, backslash ) ) );
+      if ( special )
+         return current + __builtin_ctz( special );
+      current += 16;
+   }
+   return findStringSpecialScalar( current, end );
+}
+
+
+# ifdef JSON_SIMD_SCAN_AVX2
+
+__attribute__(( target( "avx2" ) )) static const char *
+findNonSpaceAVX2( const char *current, const char *end )
+{
+   while ( end - current >= 32 )
+   {
+      __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( current ) );
+      __m256i space = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( ' ' ) ),
+                                                        _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( '\t' ) ) ),
+                                       _mm256_or_si256( _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( '\r' ) ),
+                                                        _mm256_cmpeq_epi8( chunk, _mm256_set1_epi8( '\n' ) ) ) );
+      unsigned int notSpace = ~unsigned( _mm256_movemask_epi8( space ) );
+      if ( notSpace )
+         return current + __builtin_ctz( notSpace );
+      current += 32;
+   }
+   return findNonSpaceSSE2( current, end );
+}
+
+
+__attribute__(( target( "avx2" ) )) static const char *
+findStringSpecialAVX2( const char *current, const char *end )
+{
+   const __m256i quote = _mm256_set1_epi8( '"' );
+   const __m256i backslash = _mm256_set1_epi8( '\\' );
+   while ( end - current >= 32 )
+   {
+      __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( current ) );
+      unsigned int special = _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, quote ),
+                                                                    _mm256_cmpeq_epi8( chunk, backslash ) ) );
+      if ( special )
+         return current + __builtin_ctz( special );
+      current += 32;
+   }
+   return findStringSpecialSSE2( current, end );
+}
+
+
+static inline bool
+cpuHasAVX2()
+{
+   static const bool hasAVX2 = __builtin_cpu_supports( "avx2" ) != 0;
+   return hasAVX2;
+}
+
+# endif // ifdef JSON_SIMD_SCAN_AVX2
+
+#endif // ifdef JSON_SIMD_SCAN
+
+
+/// Returns the first character in [current,end[ that is not whitespace, or end.
+static inline const char *
+findNonSpace( const char *current, const char *end )
+{
+   // Most runs of whitespace in a document are a single character or none at all.
+   if ( current == end  ||  !isJsonSpace( *current ) )
+      return current;
+   ++current;
+   if ( current == end  ||  !isJsonSpace( *current ) )
+      return current;
+#if defined(JSON_SIMD_SCAN_AVX2)
+   if ( cpuHasAVX2() )
+      return findNonSpaceAVX2( current, end );
+#endif
+#if defined(JSON_SIMD_SCAN)
+   return findNonSpaceSSE2( current, end );
+#else
+   return findNonSpaceScalar( current, end );
+#endif
+}
+
+
+/// Returns the first '"' or '\\' in [current,end[, or end.
+static inline const char *
+findStringSpecial( const char *current, const char *end )
+{
+#if defined(JSON_SIMD_SCAN_AVX2)
+   if ( cpuHasAVX2() )
+      return findStringSpecialAVX2( current, end );
+#endif
+#if defined(JSON_SIMD_SCAN)
+   return findStringSpecialSSE2( current, end );
+#else
+   return findStringSpecialScalar( current, end );
+#endif
+}
+
+} // namespace Json
+
+#endif // LIB_JSONCPP_JSON_SCAN_H_INCLUDED
@@ -73,6 +73,147 @@ releaseStringValue( char *value )
       free( value );
 }
 
+
+/** Compares two strings given as ranges, like strcmp() does for zero
+ * terminated ones.
+ */
+static inline int
+compareStringRanges( const char *begin, const char *end, 
+                     const char *otherBegin, const char *otherEnd )
+{
+   size_t length = end - begin;
+   size_t otherLength = otherEnd - otherBegin;
+   int comp = memcmp( begin, otherBegin, length < otherLength ? length : otherLength );
+   if ( comp != 0 )
+      return comp;
+   return length < otherLength ? -1 : ( length > otherLength ? 1 : 0 );
+}
+
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class ValueArena
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+// Every allocation is rounded up to this, which is enough for any Value node.
+static const size_t arenaAlignment = 16;
+
+static inline size_t
+arenaAlign( size_t size )
+{
+   return (size + arenaAlignment - 1) & ~(arenaAlignment - 1);
+}
+
+
+ValueArena::ValueArena( unsigned int pageSize )
+   : pages_( 0 )
+   , currentPage_( 0 )
+   , largeAllocations_( 0 )
+   , current_( 0 )
+   , end_( 0 )
+   , pageSize_( (unsigned int)arenaAlign( pageSize < 1024 ? 1024 : pageSize ) )
+{
+}
+
+
+ValueArena::~ValueArena()
+{
+   reset();
+   while ( pages_ )
+   {
+      Page *next = pages_->next_;
+      free( pages_ );
+      pages_ = next;
+   }
+}
+
+
+char *
+ValueArena::pageData( Page *page ) const
+{
+   return reinterpret_cast<char *>( page ) + arenaAlign( sizeof(Page) );
+}
+
+
+void *
+ValueArena::allocate( size_t size )
+{
+   size = arenaAlign( size ? size : 1 );
+   if ( size_t(end_ - current_) >= size )
+   {
+      void *block = current_;
+      current_ += size;
+      return block;
+   }
+   return allocateSlow( size );
+}
+
+
+void *
+ValueArena::allocateSlow( size_t size )
+{
+   // Big blocks get their own allocation so they don't waste the rest of a page.
+   if ( size > pageSize_ / 4 )
+   {
+      Page *page = static_cast<Page *>( malloc( arenaAlign( sizeof(Page) ) + size ) );
+      JSON_ASSERT_MESSAGE( page != 0, "Failed to allocate arena block" );
+      page->size_ = size;
+      page->next_ = largeAllocations_;
+      largeAllocations_ = page;
+      return pageData( page );
+   }
+
+   // Move on to the next page, reusing the ones kept by reset() first.
+   Page *page = currentPage_ ? currentPage_->next_ : pages_;
+   if ( !page )
+   {
+      page = static_cast<Page *>( malloc( arenaAlign( sizeof(Page) ) + pageSize_ ) );
+      JSON_ASSERT_MESSAGE( page != 0, "Failed to allocate arena page" );
+      page->size_ = pageSize_;
+      page->next_ = 0;
+      if ( currentPage_ )
+         currentPage_->next_ = page;
+      else
+         pages_ = page;
+   }
+   currentPage_ = page;
+   current_ = pageData( page );
+   end_ = current_ + page->size_;
+
+   void *block = current_;
+   current_ += size;
+   return block;
+}
+
+
+char *
+ValueArena::duplicateString( const char *value, 
+                             unsigned int length )
+{
+   char *newString = static_cast<char *>( allocate( length + 1 ) );
+   memcpy( newString, value, length );
+   newString[length] = 0;
+   return newString;
+}
+
+
+void 
+ValueArena::reset()
+{
+   while ( largeAllocations_ )
+   {
+      Page *next = largeAllocations_->next_;
+      free( largeAllocations_ );
+      largeAllocations_ = next;
+   }
+   currentPage_ = pages_;
+   current_ = pages_ ? pageData( pages_ ) : 0;
+   end_ = pages_ ? current_ + pages_->size_ : 0;
+}
+
 } // namespace Json
 
 
@@ -153,10 +294,10 @@ Value::CZString::CZString( const char *cstr, DuplicationPolicy allocate )
 }
 
 Value::CZString::CZString( const CZString &other )
-: cstr_( other.index_ != noDuplication &&  other.cstr_ != 0
+: cstr_( other.index_ != noDuplication &&  other.index_ != inArena  &&  other.cstr_ != 0
                 ?  duplicateStringValue( other.cstr_ )
                 : other.cstr_ )
-   , index_( other.cstr_ ? (other.index_ == noDuplication ? noDuplication : duplicate)
+   , index_( other.cstr_ ? (other.index_ == noDuplication  ||  other.index_ == inArena ? other.index_ : duplicate)
                          : other.index_ )
 {
 }
@@ -218,6 +359,12 @@ Value::CZString::isStaticString() const
    return index_ == noDuplication;
 }
 
+bool 
+Value::CZString::isInArena() const
+{
+   return cstr_ != 0  &&  index_ == inArena;
+}
+
 #endif // ifndef JSON_VALUE_USE_INTERNAL_MAP
 
 
@@ -236,6 +383,9 @@ Value::CZString::isStaticString() const
 Value::Value( ValueType type )
    : type_( type )
    , allocated_( 0 )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -280,6 +430,9 @@ Value::Value( ValueType type )
 #if defined(JSON_HAS_INT64)
 Value::Value( UInt value )
    : type_( uintValue )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -290,6 +443,9 @@ Value::Value( UInt value )
 
 Value::Value( Int value )
    : type_( intValue )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -303,6 +459,9 @@ Value::Value( Int value )
 
 Value::Value( Int64 value )
    : type_( intValue )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -314,6 +473,9 @@ Value::Value( Int64 value )
 
 Value::Value( UInt64 value )
    : type_( uintValue )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -324,6 +486,9 @@ Value::Value( UInt64 value )
 
 Value::Value( double value )
    : type_( realValue )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -335,6 +500,9 @@ Value::Value( double value )
 Value::Value( const char *value )
    : type_( stringValue )
    , allocated_( true )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -348,6 +516,9 @@ Value::Value( const char *beginValue,
               const char *endValue )
    : type_( stringValue )
    , allocated_( true )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -358,9 +529,58 @@ Value::Value( const char *beginValue,
 }
 
 
+Value::Value( ValueType type, 
+              ValueArena &arena )
+   : type_( type )
+   , allocated_( 0 )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
+   , comments_( 0 )
+# ifdef JSON_VALUE_USE_INTERNAL_MAP
+   , itemIsUsed_( 0 )
+#endif
+{
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   if ( type == arrayValue  ||  type == objectValue )
+   {
+      void *storage = arena.allocate( sizeof(ObjectValues) );
+      value_.map_ = new (storage) ObjectValues( std::less<CZString>(),
+                                                ValueArenaAllocator<ObjectValues::value_type>( &arena ) );
+      inArena_ = 1;
+      return;
+   }
+#endif
+   // Other types don't allocate anything.
+   Value temp( type );
+   std::swap( value_, temp.value_ );
+}
+
+
+Value::Value( const char *beginValue, 
+              const char *endValue,
+              ValueArena &arena )
+   : type_( stringValue )
+   , allocated_( false )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
+   , comments_( 0 )
+# ifdef JSON_VALUE_USE_INTERNAL_MAP
+   , itemIsUsed_( 0 )
+#endif
+{
+   value_.string_ = arena.duplicateString( beginValue, 
+                                           (unsigned int)(endValue - beginValue) );
+}
+
+
 Value::Value( const std::string &value )
    : type_( stringValue )
    , allocated_( true )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -374,6 +594,9 @@ Value::Value( const std::string &value )
 Value::Value( const StaticString &value )
    : type_( stringValue )
    , allocated_( false )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -383,10 +606,28 @@ Value::Value( const StaticString &value )
 }
 
 
+Value::Value( const BorrowedString &value )
+   : type_( stringValue )
+   , allocated_( false )
+   , inArena_( 0 )
+   , borrowed_( 1 )
+   , stringLength_( (unsigned int)(value.end() - value.begin()) )
+   , comments_( 0 )
+# ifdef JSON_VALUE_USE_INTERNAL_MAP
+   , itemIsUsed_( 0 )
+#endif
+{
+   value_.string_ = const_cast<char *>( value.begin() );
+}
+
+
 # ifdef JSON_USE_CPPTL
 Value::Value( const CppTL::ConstString &value )
    : type_( stringValue )
    , allocated_( true )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -398,6 +639,9 @@ Value::Value( const CppTL::ConstString &value )
 
 Value::Value( bool value )
    : type_( booleanValue )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -409,6 +653,9 @@ Value::Value( bool value )
 
 Value::Value( const Value &other )
    : type_( other.type_ )
+   , inArena_( 0 )
+   , borrowed_( 0 )
+   , stringLength_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -424,7 +671,13 @@ Value::Value( const Value &other )
       value_ = other.value_;
       break;
    case stringValue:
-      if ( other.value_.string_ )
+      borrowed_ = 0;
+      if ( other.borrowed_ )
+      {
+         value_.string_ = duplicateStringValue( other.value_.string_, other.stringLength_ );
+         allocated_ = true;
+      }
+      else if ( other.value_.string_ )
       {
          value_.string_ = duplicateStringValue( other.value_.string_ );
          allocated_ = true;
@@ -435,7 +688,21 @@ Value::Value( const Value &other )
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      value_.map_ = new ObjectValues( *other.value_.map_ );
+      inArena_ = 0;
+      if ( other.inArena_ )
+      {
+         // The copy must outlive the arena: member names are duplicated as well.
+         value_.map_ = new ObjectValues();
+         ObjectValues::const_iterator itEnd = other.value_.map_->end();
+         for ( ObjectValues::const_iterator it = other.value_.map_->begin(); it != itEnd; ++it )
+         {
+            CZString key = (*it).first.isInArena() ? CZString( (*it).first.c_str(), CZString::duplicateOnCopy )
+                                                   : (*it).first;
+            value_.map_->insert( value_.map_->end(), ObjectValues::value_type( key, (*it).second ) );
+         }
+      }
+      else
+         value_.map_ = new ObjectValues( *other.value_.map_ );
       break;
 #else
    case arrayValue:
@@ -478,7 +745,10 @@ Value::~Value()
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      delete value_.map_;
+      if ( inArena_ )
+         value_.map_->~ObjectValues();
+      else
+         delete value_.map_;
       break;
 #else
    case arrayValue:
@@ -514,6 +784,13 @@ Value::swap( Value &other )
    int temp2 = allocated_;
    allocated_ = other.allocated_;
    other.allocated_ = temp2;
+   unsigned int temp3 = inArena_;
+   inArena_ = other.inArena_;
+   other.inArena_ = temp3;
+   temp3 = borrowed_;
+   borrowed_ = other.borrowed_;
+   other.borrowed_ = temp3;
+   std::swap( stringLength_, other.stringLength_ );
 }
 
 ValueType 
@@ -553,10 +830,15 @@ Value::operator <( const Value &other ) const
    case booleanValue:
       return value_.bool_ < other.value_.bool_;
    case stringValue:
-      return ( value_.string_ == 0  &&  other.value_.string_ )
-             || ( other.value_.string_  
-                  &&  value_.string_  
-                  && strcmp( value_.string_, other.value_.string_ ) < 0 );
+      {
+         const char *begin = 0, *end = 0, *otherBegin = 0, *otherEnd = 0;
+         getString( &begin, &end );
+         other.getString( &otherBegin, &otherEnd );
+         return ( begin == 0  &&  otherBegin )
+                || ( otherBegin  
+                     &&  begin  
+                     && compareStringRanges( begin, end, otherBegin, otherEnd ) < 0 );
+      }
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
@@ -619,10 +901,15 @@ Value::operator ==( const Value &other ) const
    case booleanValue:
       return value_.bool_ == other.value_.bool_;
    case stringValue:
-      return ( value_.string_ == other.value_.string_ )
-             || ( other.value_.string_  
-                  &&  value_.string_  
-                  && strcmp( value_.string_, other.value_.string_ ) == 0 );
+      {
+         const char *begin = 0, *end = 0, *otherBegin = 0, *otherEnd = 0;
+         getString( &begin, &end );
+         other.getString( &otherBegin, &otherEnd );
+         return ( begin == otherBegin  &&  end == otherEnd )
+                || ( otherBegin  
+                     &&  begin  
+                     && compareStringRanges( begin, end, otherBegin, otherEnd ) == 0 );
+      }
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
@@ -650,10 +937,33 @@ const char *
 Value::asCString() const
 {
    JSON_ASSERT( type_ == stringValue );
+   JSON_ASSERT_MESSAGE( !borrowed_, "Borrowed string is not zero terminated, use asString() or getString()" );
    return value_.string_;
 }
 
 
+bool 
+Value::getString( const char **begin, 
+                  const char **end ) const
+{
+   if ( type_ != stringValue )
+      return false;
+   *begin = value_.string_;
+   if ( borrowed_ )
+      *end = value_.string_ + stringLength_;
+   else
+      *end = value_.string_ ? value_.string_ + strlen( value_.string_ ) : 0;
+   return true;
+}
+
+
+bool 
+Value::isBorrowedString() const
+{
+   return type_ == stringValue  &&  borrowed_;
+}
+
+
 std::string 
 Value::asString() const
 {
@@ -662,6 +972,8 @@ Value::asString() const
    case nullValue:
       return "";
    case stringValue:
+      if ( borrowed_ )
+         return std::string( value_.string_, stringLength_ );
       return value_.string_ ? value_.string_ : "";
    case booleanValue:
       return value_.bool_ ? "true" : "false";
@@ -899,6 +1211,8 @@ Value::asBool() const
    case booleanValue:
       return value_.bool_;
    case stringValue:
+      if ( borrowed_ )
+         return stringLength_ != 0;
       return value_.string_  &&  value_.string_[0] != 0;
    case arrayValue:
    case objectValue:
@@ -947,7 +1261,8 @@ Value::isConvertibleTo( ValueType other ) const
              || other == booleanValue;
    case stringValue:
       return other == stringValue
-             || ( other == nullValue  &&  (!value_.string_  ||  value_.string_[0] == 0) );
+             || ( other == nullValue  &&  ( borrowed_ ? stringLength_ == 0
+                                                      : (!value_.string_  ||  value_.string_[0] == 0) ) );
    case arrayValue:
       return other == arrayValue
              ||  ( other == nullValue  &&  value_.map_->size() == 0 );
@@ -1153,6 +1468,31 @@ Value::resolveReference( const char *key,
 }
 
 
+Value &
+Value::resolveMember( const char *key, 
+                      ValueArena &arena )
+{
+   JSON_ASSERT( type_ == nullValue  ||  type_ == objectValue );
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   if ( type_ == nullValue )
+   {
+      Value temp( objectValue, arena );
+      swap( temp );
+   }
+   CZString actualKey( key, CZString::noDuplication );
+   ObjectValues::iterator it = value_.map_->lower_bound( actualKey );
+   if ( it != value_.map_->end()  &&  (*it).first == actualKey )
+      return (*it).second;
+
+   CZString arenaKey( arena.duplicateString( key, (unsigned int)strlen( key ) ), CZString::inArena );
+   it = value_.map_->insert( it, ObjectValues::value_type( arenaKey, null ) );
+   return (*it).second;
+#else
+   return resolveReference( key, false );
+#endif
+}
+
+
 Value 
 Value::get( ArrayIndex index, 
             const Value &defaultValue ) const
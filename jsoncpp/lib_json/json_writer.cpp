@@ -180,6 +180,15 @@ std::string valueToQuotedString( const char *value )
    return result;
 }
 
+/// Quotes a string value. Borrowed strings aren't zero terminated, so they go through a copy.
+static std::string 
+quotedStringValue( const Value &value )
+{
+   if ( value.isBorrowedString() )
+      return valueToQuotedString( value.asString().c_str() );
+   return valueToQuotedString( value.asCString() );
+}
+
 // Class Writer
 // //////////////////////////////////////////////////////////////////
 Writer::~Writer()
@@ -231,7 +240,7 @@ FastWriter::writeValue( const Value &value )
       document_ += valueToString( value.asDouble() );
       break;
    case stringValue:
-      document_ += valueToQuotedString( value.asCString() );
+      document_ += quotedStringValue( value );
       break;
    case booleanValue:
       document_ += valueToString( value.asBool() );
@@ -314,7 +323,7 @@ StyledWriter::writeValue( const Value &value )
       pushValue( valueToString( value.asDouble() ) );
       break;
    case stringValue:
-      pushValue( valueToQuotedString( value.asCString() ) );
+      pushValue( quotedStringValue( value ) );
       break;
    case booleanValue:
       pushValue( valueToString( value.asBool() ) );
@@ -590,7 +599,7 @@ StyledStreamWriter::writeValue( const Value &value )
       pushValue( valueToString( value.asDouble() ) );
       break;
    case stringValue:
-      pushValue( valueToQuotedString( value.asCString() ) );
+      pushValue( quotedStringValue( value ) );
       break;
    case booleanValue:
       pushValue( valueToString( value.asBool() ) );
@@ -10,6 +10,8 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 #include "listing.h"
 #include <iostream>
 
+const std::vector<unsigned int> Listing::noTokens;
+
 void Listing::dump()
 {
         std::cout << "title: " << titleBase << std::endl;
@@ -12,11 +12,10 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 #include <string>
 #include <vector>
 #include <tr1/memory>
-#include <boost/thread.hpp>
+#include <stdexcept>
+#include "stringTable.h"
 
-struct Product;
-
-//Represents a listing. We also keep track of the best matched product for this listing.
+//Represents a listing. The best matched product for it is kept in Datas, see MatchStates.
 class Listing
 {
     std::string titleBase;
@@ -25,47 +24,81 @@ class Listing
     std::string priceBase;
 
     std::vector<unsigned int> title;
-    std::vector<unsigned int> manufacturer;
-    std::vector<unsigned int> currency;
-    std::vector<unsigned int> price;
 
-    std::tr1::shared_ptr<Product> bestMatchedProduct;
-    float bestMatchedWeight;
-    boost::mutex listingLock;
+    //These repeat a lot from listing to listing, so listings with the same value share one copy
+    SharedTokens manufacturer;
+    SharedTokens currency;
+    SharedTokens price;
 
-public:    
-    Listing()
+    static const std::vector<unsigned int> noTokens;
+
+    static const std::vector<unsigned int> &getTokens(const SharedTokens &tokens) { return (tokens != NULL) ? *tokens : noTokens; }
+
+    unsigned int normalizedFields; //Field bits of the fields whose tokens have been set
+    unsigned int corpusFields; //Field bits of the fields whose tokens were handed over to the ListingCorpus
+
+    //A field that was never normalized has no tokens, so anything reading it would silently match against nothing
+    void checkNormalized(unsigned int field) const
     {
-        bestMatchedWeight = -99999.0f;
-    }//constuctor
+        if ((normalizedFields & field) == 0) {
+            throw std::logic_error("Listing field was never normalized, see FieldSet");
+        }//if
+        if ((corpusFields & field) != 0) {
+            throw std::logic_error("Listing field is only kept in the ListingCorpus once the listing is in Datas");
+        }//if
+    }//checkNormalized
+
+public:    
+    //The normalized fields, as bits for saying which of them are normalized (see FieldSet in datas.h)
+    enum Field { TitleField = 1, ManufacturerField = 2, CurrencyField = 4, PriceField = 8 };
 
-    boost::mutex &getListingLock() { return listingLock; }
+    Listing() : normalizedFields(0), corpusFields(0) {}
+
+    bool isNormalized(Field field) const { return (normalizedFields & field) != 0; }
 
     std::string &getTitleBase() { return titleBase; }
     std::string &getManufacturerBase() { return manufacturerBase; }
     std::string &getCurrencyBase() { return currencyBase; }
     std::string &getPriceBase() { return priceBase; }
 
-    std::vector<unsigned int> &getTitle() { return title; }
-    std::vector<unsigned int> &getManufacturer() { return manufacturer; }
-    std::vector<unsigned int> &getCurrency() { return currency; }
-    std::vector<unsigned int> &getPrice() { return price; }
-
-    std::tr1::shared_ptr<Product> getBestMatchedProduct() { return bestMatchedProduct; }
-    float getBestMatchedWeight() { return bestMatchedWeight; }
+    const std::string &getTitleBase() const { return titleBase; }
+    const std::string &getManufacturerBase() const { return manufacturerBase; }
+    const std::string &getCurrencyBase() const { return currencyBase; }
+    const std::string &getPriceBase() const { return priceBase; }
 
-    void setBestMatchedProduct(std::tr1::shared_ptr<Product> product) { bestMatchedProduct = product; }
-    void setBestMatchedWeight(float weight) { bestMatchedWeight = weight; }
+    //Only for normalized fields, throws std::logic_error for the others. The title and manufacturer
+    //tokens are only here until the listing is added to Datas, after that they're in the ListingCorpus.
+    const std::vector<unsigned int> &getTitle() const { checkNormalized(TitleField); return title; }
+    const std::vector<unsigned int> &getManufacturer() const { checkNormalized(ManufacturerField); return getTokens(manufacturer); }
+    const std::vector<unsigned int> &getCurrency() const { checkNormalized(CurrencyField); return getTokens(currency); }
+    const std::vector<unsigned int> &getPrice() const { checkNormalized(PriceField); return getTokens(price); }
 
     void setTitleBase(const std::string &str) { titleBase = str; }
     void setManufacturerBase(const std::string &str) { manufacturerBase = str; }
     void setCurrencyBase(const std::string &str) { currencyBase = str; }
     void setPriceBase(const std::string &str) { priceBase = str; }
 
-    void setTitle(std::vector<unsigned int> vec) { title = vec; }
-    void setManufacturer(std::vector<unsigned int> vec) { manufacturer = vec; }
-    void setCurrency(std::vector<unsigned int> vec) { currency = vec; }
-    void setPrice(std::vector<unsigned int> vec) { price = vec; }
+    void setTitleBase(const char *begin, const char *end) { titleBase.assign(begin, end); }
+    void setManufacturerBase(const char *begin, const char *end) { manufacturerBase.assign(begin, end); }
+    void setCurrencyBase(const char *begin, const char *end) { currencyBase.assign(begin, end); }
+    void setPriceBase(const char *begin, const char *end) { priceBase.assign(begin, end); }
+
+    void setTitle(std::vector<unsigned int> vec) { title = vec; normalizedFields |= TitleField; }
+    void setManufacturer(std::vector<unsigned int> vec) { manufacturer.reset(new std::vector<unsigned int>(vec)); normalizedFields |= ManufacturerField; }
+    void setCurrency(std::vector<unsigned int> vec) { currency.reset(new std::vector<unsigned int>(vec)); normalizedFields |= CurrencyField; }
+    void setPrice(std::vector<unsigned int> vec) { price.reset(new std::vector<unsigned int>(vec)); normalizedFields |= PriceField; }
+
+    void setManufacturer(SharedTokens tokens) { manufacturer = tokens; normalizedFields |= ManufacturerField; }
+    void setCurrency(SharedTokens tokens) { currency = tokens; normalizedFields |= CurrencyField; }
+    void setPrice(SharedTokens tokens) { price = tokens; normalizedFields |= PriceField; }
+
+    //Free the title and manufacturer tokens, once the ListingCorpus has its own copy
+    void dropCorpusFields()
+    {
+        std::vector<unsigned int>().swap(title);
+        manufacturer.reset();
+        corpusFields = TitleField | ManufacturerField;
+    }//dropCorpusFields
 
     void dump();
 };//Listing
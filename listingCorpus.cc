@@ -0,0 +1,27 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#include "listingCorpus.h"
+#include "listing.h"
+
+namespace
+{
+
+//The row of a field that wasn't normalized
+const std::vector<unsigned int> noTokens;
+
+}//anonymous namespace
+
+//Append the listing's tokens as the next row, and drop them from the listing
+void ListingCorpus::addListing(Listing &listing)
+{
+    titles.addRow(listing.isNormalized(Listing::TitleField) ? listing.getTitle() : noTokens);
+    manufacturers.addRow(listing.isNormalized(Listing::ManufacturerField) ? listing.getManufacturer() : noTokens);
+
+    listing.dropCorpusFields();
+}//addListing
@@ -0,0 +1,68 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __LISTINGCORPUS_H
+#define __LISTINGCORPUS_H
+
+#include <vector>
+
+class Listing;
+
+//One normalized field of every listing, with all their tokens back to back in one array. Listing
+//n's tokens run from offsets[n] to offsets[n + 1] (compressed sparse rows).
+class TokenColumn
+{
+    std::vector<unsigned int> tokens;
+    std::vector<unsigned int> offsets;
+
+public:
+    TokenColumn() : offsets(1, 0) {}
+
+    void addRow(const std::vector<unsigned int> &rowTokens)
+    {
+        tokens.insert(tokens.end(), rowTokens.begin(), rowTokens.end());
+        offsets.push_back(tokens.size());
+    }//addRow
+
+    const unsigned int *rowBegin(unsigned int row) const { return tokens.data() + offsets[row]; }
+    const unsigned int *rowEnd(unsigned int row) const { return tokens.data() + offsets[row + 1]; }
+    unsigned int rowSize(unsigned int row) const { return offsets[row + 1] - offsets[row]; }
+
+    unsigned int getNumRows() const { return offsets.size() - 1; }
+
+    void reserveRows(unsigned int numRows) { offsets.reserve(numRows + 1); }
+};//TokenColumn
+
+//The listings as the matcher sees them: a column for each normalized field it reads, with listings
+//addressed by their index in Datas. Scanning a field over all the listings walks two contiguous
+//arrays rather than going through a shared_ptr, a Listing and a vector for each one. The raw text
+//and everything else stay behind in the Listings, which the matcher doesn't touch.
+//
+//This is the only copy of those tokens: a listing's are moved here as it's added to Datas.
+class ListingCorpus
+{
+    TokenColumn titles;
+    TokenColumn manufacturers;
+
+public:
+    //Append the listing's tokens as the next row, and drop them from the listing
+    void addListing(Listing &listing);
+
+    void reserve(unsigned int numListings)
+    {
+        titles.reserveRows(numListings);
+        manufacturers.reserveRows(numListings);
+    }//reserve
+
+    const TokenColumn &getTitles() const { return titles; }
+    const TokenColumn &getManufacturers() const { return manufacturers; }
+
+    unsigned int getNumListings() const { return titles.getNumRows(); }
+};//ListingCorpus
+
+#endif
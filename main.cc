@@ -13,54 +13,224 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 #include "product.h"
 #include "listing.h"
 #include "datas.h"
+#include "mappedFile.h"
+#include "recordDecoder.h"
+#include "snapshot.h"
+#include "ingestPipeline.h"
 #include "adhoc/adhoc.h"
 
 #include <iostream>
 #include <json/json.h>
 #include <fstream>
+#include <algorithm>
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
 
 namespace
 {
 
-//For JSON instance, grab a new listing
-void importListing(Datas &datas, Json::Value &listingRoot)
+//Schema of a listings.txt line
+typedef RecordDecoder<Listing,
+            RecordField<Listing, &Listing::setTitleBase, 't','i','t','l','e'>,
+            RecordField<Listing, &Listing::setManufacturerBase, 'm','a','n','u','f','a','c','t','u','r','e','r'>,
+            RecordField<Listing, &Listing::setCurrencyBase, 'c','u','r','r','e','n','c','y'>,
+            RecordField<Listing, &Listing::setPriceBase, 'p','r','i','c','e'>
+        > ListingDecoder;
+
+//Schema of a products.txt line
+typedef RecordDecoder<Product,
+            RecordField<Product, &Product::setProductNameBase, 'p','r','o','d','u','c','t','_','n','a','m','e'>,
+            RecordField<Product, &Product::setManufacturerBase, 'm','a','n','u','f','a','c','t','u','r','e','r'>,
+            RecordField<Product, &Product::setFamilyBase, 'f','a','m','i','l','y'>,
+            RecordField<Product, &Product::setModelBase, 'm','o','d','e','l'>,
+            RecordField<Product, &Product::setAnnouncedDateBase, 'a','n','n','o','u','n','c','e','d','-','d','a','t','e'>
+        > ProductDecoder;
+
+//Fill in the normalized versions of the given fields of a listing (a mask of Listing::Field). Only the
+//raw fields are filled in by the decoding threads; this runs on the pipeline's normalize threads, which
+//share the string table, for the fields in datas.normalizedFields. A field the ListingCorpus doesn't
+//hold (currency, price) can be normalized later on, as long as the string table hasn't been frozen
+//yet; the title and manufacturer have to be done before the listing is added to Datas.
+//Titles are nearly all different; the other fields mostly aren't, so they go through the cache.
+void normalizeListingFields(Datas &datas, Listing &listing, unsigned int fields)
 {
-    std::tr1::shared_ptr<Listing> newListing(new Listing);
+    if ((fields & Listing::TitleField) != 0) {
+        listing.setTitle(adhocStringNormalize(listing.getTitleBase(), datas.stringTable));
+    }//if
+    if ((fields & Listing::ManufacturerField) != 0) {
+        listing.setManufacturer(datas.normalizeCache.normalize(listing.getManufacturerBase()));
+    }//if
+    if ((fields & Listing::CurrencyField) != 0) {
+        listing.setCurrency(datas.normalizeCache.normalize(listing.getCurrencyBase()));
+    }//if
+    if ((fields & Listing::PriceField) != 0) {
+        listing.setPrice(datas.normalizeCache.normalize(listing.getPriceBase()));
+    }//if
+}//normalizeListingFields
 
-    newListing->setTitleBase(listingRoot.get("title", "").asString());
-    newListing->setManufacturerBase(listingRoot.get("manufacturer", "").asString());
-    newListing->setCurrencyBase(listingRoot.get("currency", "").asString());
-    newListing->setPriceBase(listingRoot.get("price", "").asString());
+//The fields the matcher reads
+void normalizeListing(Datas &datas, Listing &listing)
+{
+    normalizeListingFields(datas, listing, datas.normalizedFields.listingFields);
+}//normalizeListing
 
-    newListing->setTitle(adhocStringNormalize(newListing->getTitleBase(), datas.stringTable));
-    newListing->setManufacturer(adhocStringNormalize(newListing->getManufacturerBase(), datas.stringTable));
-    newListing->setCurrency(adhocStringNormalize(newListing->getCurrencyBase(), datas.stringTable));
-    newListing->setPrice(adhocStringNormalize(newListing->getPriceBase(), datas.stringTable));
+//Same as normalizeListingFields, for a product (fields is a mask of Product::Field)
+void normalizeProductFields(Datas &datas, Product &product, unsigned int fields)
+{
+    if ((fields & Product::ProductNameField) != 0) {
+        product.setProductName(adhocStringNormalize(product.getProductNameBase(), datas.stringTable));
+    }//if
+    if ((fields & Product::ManufacturerField) != 0) {
+        product.setManufacturer(*datas.normalizeCache.normalize(product.getManufacturerBase()));
+    }//if
+    if ((fields & Product::FamilyField) != 0) {
+        product.setFamily(adhocStringNormalize(product.getFamilyBase(), datas.stringTable));
+    }//if
+    if ((fields & Product::ModelField) != 0) {
+        product.setModel(adhocStringNormalize(product.getModelBase(), datas.stringTable));
+    }//if
+    if ((fields & Product::AnnouncedDateField) != 0) {
+        product.setAnnouncedDate(adhocStringNormalize(product.getAnnouncedDateBase(), datas.stringTable));
+    }//if
+}//normalizeProductFields
 
-    datas.addListing(newListing);
-}//importListing
+//The fields the matcher reads
+void normalizeProduct(Datas &datas, Product &product)
+{
+    normalizeProductFields(datas, product, datas.normalizedFields.productFields);
+}//normalizeProduct
 
-//For JSON instance, grab a new product
-void importProduct(Datas &datas, Json::Value &productRoot)
+//Soak up the listing data in [begin, end) of listingFile. Listings are added to datas in file order.
+bool importListings(Datas &datas, const MappedFile &listingFile, const char *begin, const char *end, const IngestOptions &options, std::string &errorMessage)
 {
-    std::tr1::shared_ptr<Product> newProduct(new Product);
+    IngestPipeline<Listing, ListingDecoder> pipeline(options,
+            boost::bind(&normalizeListing, boost::ref(datas), _1),
+            boost::bind(&Datas::addListing, &datas, _1),
+            "listing");
 
-    newProduct->setProductNameBase(productRoot.get("product_name", "").asString());
-    newProduct->setManufacturerBase(productRoot.get("manufacturer", "").asString());
-    newProduct->setFamilyBase(productRoot.get("family", "").asString());
-    newProduct->setModelBase(productRoot.get("model", "").asString());
-    newProduct->setAnnouncedDateBase(productRoot.get("announced-date", "").asString());
+    return pipeline.run(listingFile, begin, end, errorMessage);
+}//importListings
 
-    newProduct->setProductName(adhocStringNormalize(newProduct->getProductNameBase(), datas.stringTable));
-    newProduct->setManufacturer(adhocStringNormalize(newProduct->getManufacturerBase(), datas.stringTable));
-    newProduct->setFamily(adhocStringNormalize(newProduct->getFamilyBase(), datas.stringTable));
-    newProduct->setModel(adhocStringNormalize(newProduct->getModelBase(), datas.stringTable));
-    newProduct->setAnnouncedDate(adhocStringNormalize(newProduct->getAnnouncedDateBase(), datas.stringTable));
+//Soak up the product data. Products are added to datas in file order.
+bool importProducts(Datas &datas, const MappedFile &productFile, const IngestOptions &options, std::string &errorMessage)
+{
+    IngestPipeline<Product, ProductDecoder> pipeline(options,
+            boost::bind(&normalizeProduct, boost::ref(datas), _1),
+            boost::bind(&Datas::addProduct, &datas, _1),
+            "product");
 
-    datas.addProduct(newProduct);
-}//importProduct
+    return pipeline.run(productFile, productFile.begin(), productFile.end(), errorMessage);
+}//importProducts
+
+//The product side of the corpus, as left behind by ingestProductSide
+struct ProductSide
+{
+    bool imported;
+    std::string errorMessage;
+    std::tr1::shared_ptr<ProductStack> productStack;
+
+    ProductSide() : imported(false) {}
+};//ProductSide
+
+//Thread worker function.. read in the products and set up the product side of the matching.
+//Runs alongside the listings being read in; the two only share the (locking) string table.
+void ingestProductSide(Datas &datas, const MappedFile &productFile, const IngestOptions &options, ProductSide &productSide)
+{
+    datas.reserveProducts(productFile.countLines());
+
+    productSide.imported = importProducts(datas, productFile, options, productSide.errorMessage);
+    if (true == productSide.imported) {
+        productSide.productStack = prepareAdhocProducts(datas);
+    }//if
+}//ingestProductSide
+
+//Map the listings and products files
+bool openCorpusFiles(const std::string &listingFileName, const std::string &productFileName, MappedFile &listingFile, MappedFile &productFile)
+{
+    if (listingFile.open(listingFileName.c_str()) == false) {
+        std::cout << "Failed to open listing file '" << listingFileName << "'" << std::endl;
+        return false;
+    }//if
+
+    if (productFile.open(productFileName.c_str()) == false) {
+        std::cout << "Failed to open product file '" << productFileName << "'" << std::endl;
+        return false;
+    }//if
+
+    return true;
+}//openCorpusFiles
+
+//Read in and normalize the whole of the listings and products files, both at the same time.
+//The products are done on their own thread, which also gets productStack ready for the matching.
+bool importCorpus(Datas &datas, MappedFile &listingFile, MappedFile &productFile, const IngestOptions &options,
+                    std::tr1::shared_ptr<ProductStack> &productStack)
+{
+    ProductSide productSide;
+    boost::thread productThread(boost::bind(&ingestProductSide, boost::ref(datas), boost::cref(productFile), boost::cref(options), boost::ref(productSide)));
+
+    datas.reserveListings(listingFile.countLines());
+
+    std::string errorMessage;
+    bool listingsImported = importListings(datas, listingFile, listingFile.begin(), listingFile.end(), options, errorMessage);
+
+    productThread.join();
+
+    // report to the user the failure and their locations in the document.
+    if (false == listingsImported) {
+        std::cout << errorMessage << std::endl;
+        return false;
+    }//if
+
+    if (false == productSide.imported) {
+        std::cout << productSide.errorMessage << std::endl;
+        return false;
+    }//if
+
+    productStack = productSide.productStack;
+
+    return true;
+}//importCorpus
+
+//Bring datas up to date with the listings and products files for an incremental run. If the state
+//saved by the previous run still describes the start of the listings file and the same products,
+//it is loaded and only the listings appended since are read in; firstNewListing is then the first of
+//those. Otherwise everything is read in and firstNewListing is 0.
+bool importIncremental(Datas &datas, const std::string &stateFileName, MappedFile &listingFile, MappedFile &productFile,
+                        const IngestOptions &options, std::tr1::shared_ptr<ProductStack> &productStack, unsigned int &firstNewListing)
+{
+    firstNewListing = 0;
+
+    SnapshotSource previousSource;
+    bool hasMatches = false;
+    std::string errorMessage;
+    if (readSnapshotSource(stateFileName, previousSource, hasMatches, errorMessage) == false) {
+        std::cout << "No usable state in '" << stateFileName << "' (" << errorMessage << "), matching everything" << std::endl;
+        return importCorpus(datas, listingFile, productFile, options, productStack);
+    }//if
+
+    if ((false == hasMatches) || (previousSource.isAppendedBy(listingFile, productFile) == false)) {
+        std::cout << "Listings or products changed since the last run, matching everything" << std::endl;
+        return importCorpus(datas, listingFile, productFile, options, productStack);
+    }//if
+
+    if (loadSnapshot(datas, stateFileName, true, boost::bind(&normalizeListingFields, boost::ref(datas), _1, _2),
+                     boost::bind(&normalizeProductFields, boost::ref(datas), _1, _2), previousSource, errorMessage) == false) {
+        std::cout << "Failed to load state '" << stateFileName << "': " << errorMessage << std::endl;
+        return false;
+    }//if
+
+    firstNewListing = datas.getNumListings();
+
+    if (importListings(datas, listingFile, listingFile.begin() + previousSource.listingsSize, listingFile.end(), options, errorMessage) == false) {
+        // report to the user the failure and their locations in the document.
+        std::cout << errorMessage << std::endl;
+        return false;
+    }//if
+
+    return true;
+}//importIncremental
 
 //Debug helper to verify imported data was correct
 void dumpData(Datas &datas)
@@ -100,14 +270,11 @@ void outputResults(Datas &datas)
 {
     std::ofstream outFile("results.json");
 
-    typedef std::pair<std::tr1::shared_ptr<Product>, std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > > ResultMapPair;
-    typedef std::pair<std::tr1::shared_ptr<Listing>, float> ResultListingPair;
-
     float acceptanceThreshold = 0.695f;
 
     //For each product, dump out an entry listing every matching listing which passes the acceptance threshold
-    BOOST_FOREACH (std::tr1::shared_ptr<ResultHolder> resultHolder, datas.getResultHolderPair()) {
-        std::string &productName = resultHolder->getProduct()->getProductNameBase();
+    BOOST_FOREACH (const std::tr1::shared_ptr<ResultHolder> &resultHolder, datas.getResultHolderPair()) {
+        std::string &productName = datas.getProduct(resultHolder->getProduct())->getProductNameBase();
         outFile << "{ \"product_name\" : \"" << escapeQuotes(productName) << "\", " ;
         outFile << "\"listings\": [";
 
@@ -118,7 +285,7 @@ void outputResults(Datas &datas)
                 continue;
             }//if
 
-            std::tr1::shared_ptr<Listing> curListing = resultHolder->getListings()[pos];
+            const std::tr1::shared_ptr<Listing> &curListing = datas.getListing(resultHolder->getListings()[pos]);
 
             if (false == firstListing) {
                 outFile << ", ";
@@ -145,13 +312,10 @@ void outputResultsFormatted(Datas &datas)
 {
     std::ofstream outFile("results.json");
 
-    typedef std::pair<std::tr1::shared_ptr<Product>, std::vector<std::pair<std::tr1::shared_ptr<Listing>, float> > > ResultMapPair;
-    typedef std::pair<std::tr1::shared_ptr<Listing>, float> ResultListingPair;
-
     float acceptanceThreshold = 0.695f;
 
-    BOOST_FOREACH (std::tr1::shared_ptr<ResultHolder> resultHolder, datas.getResultHolderPair()) {
-        std::string &productName = resultHolder->getProduct()->getProductNameBase();
+    BOOST_FOREACH (const std::tr1::shared_ptr<ResultHolder> &resultHolder, datas.getResultHolderPair()) {
+        std::string &productName = datas.getProduct(resultHolder->getProduct())->getProductNameBase();
         outFile << "{ \"product_name\" : \"" << escapeQuotes(productName) << "\", " << std::endl;
         outFile << "   \"listings\": [" << std::endl;
 
@@ -163,7 +327,7 @@ void outputResultsFormatted(Datas &datas)
                 continue;
             }//if
 
-            std::tr1::shared_ptr<Listing> curListing = resultHolder->getListings()[pos];
+            const std::tr1::shared_ptr<Listing> &curListing = datas.getListing(resultHolder->getListings()[pos]);
 
             if (false == firstListing) {
                 outFile << "," << std::endl;
@@ -188,84 +352,210 @@ void outputResultsFormatted(Datas &datas)
 //Debug helper to verify I correctly wrote out the results
 void verifyWrittenJSON()
 {
-    std::string inLine;
-    std::ifstream resultsFile("results.json");
-    while (std::getline(resultsFile, inLine)) {
-        if (inLine.length() == 0) {
+    MappedFile resultsFile;
+    if (resultsFile.open("results.json") == false) {
+        std::cout << "Failed to open results file" << std::endl;
+        return;
+    }//if
+
+    const char *filePos = resultsFile.begin();
+    const char *lineBegin;
+    const char *lineEnd;
+    //Each line's tree is thrown away once it's parsed, so build them all in one arena and let
+    //strings point into the mapping
+    Json::ValueArena arena;
+    Json::Value productRoot;
+    Json::Reader productReader;
+    productReader.setValueArena(&arena);
+    productReader.setBorrowStrings(true);
+    while (nextLine(filePos, resultsFile.end(), lineBegin, lineEnd)) {
+        if (lineBegin == lineEnd) {
             continue;
         }//if
 
-        Json::Value productRoot;
-        Json::Reader productReader;
-        bool parsingSuccessful = productReader.parse(inLine, productRoot);
+        bool parsingSuccessful = productReader.parse(lineBegin, lineEnd, productRoot);
         if (false == parsingSuccessful) {
             // report to the user the failure and their locations in the document.
             std::cout << "Failed to parse results configuration" << std::endl << productReader.getFormattedErrorMessages();
-            std::cout << "line was: '" << inLine << "'" << std::endl;
+            std::cout << "line was: '" << std::string(lineBegin, lineEnd) << "'" << std::endl;
             return;
         }//if
     }//while
 }//verifyWrittenJSON
 
+//What to do, as given on the command line
+struct CommandLine
+{
+    std::string listingFileName;
+    std::string productFileName;
+    std::string loadSnapshotFileName;  //Start from this snapshot instead of the listings and products files
+    std::string writeSnapshotFileName; //Save the corpus here once it's loaded
+    std::string stateFileName;         //Incremental mode: carry on from the state left here by the last run
+    unsigned int numThreads;
+    unsigned int decodeThreads;        //Threads per ingest stage, 0 for numThreads
+    unsigned int normalizeThreads;
+    AdhocMatchingMode matchingMode;
+
+    CommandLine() : numThreads(0), decodeThreads(0), normalizeThreads(0), matchingMode(ProductParallelMatching) {}
+};//CommandLine
+
+void printUsage(const char *programName)
+{
+    std::cout << "Usage: " << programName << " [--write-snapshot <snapshot>] <listings.txt> <products.txt> <numThreads>" << std::endl;
+    std::cout << "       " << programName << " --snapshot <snapshot> [--write-snapshot <snapshot>] <numThreads>" << std::endl;
+    std::cout << "       " << programName << " --incremental <state> <listings.txt> <products.txt> <numThreads>" << std::endl;
+    std::cout << "Reading the listings and products files also takes --decode-threads <n> and --normalize-threads <n>" << std::endl;
+    std::cout << "Matching splits the work up by products, or with --matching listings by listings" << std::endl;
+}//printUsage
+
+//Switches come first, then the file names (unless starting from a snapshot) and the number of threads
+bool parseCommandLine(int argc, const char* argv[], CommandLine &commandLine)
+{
+    int argPos = 1;
+    while ((argPos < argc) && (strncmp(argv[argPos], "--", 2) == 0)) {
+        std::string option = argv[argPos];
+        if (argPos + 1 >= argc) {
+            return false;
+        }//if
+
+        if ("--snapshot" == option) {
+            commandLine.loadSnapshotFileName = argv[argPos + 1];
+        } else if ("--write-snapshot" == option) {
+            commandLine.writeSnapshotFileName = argv[argPos + 1];
+        } else if ("--incremental" == option) {
+            commandLine.stateFileName = argv[argPos + 1];
+        } else if ("--matching" == option) {
+            std::string mode = argv[argPos + 1];
+            if ("products" == mode) {
+                commandLine.matchingMode = ProductParallelMatching;
+            } else if ("listings" == mode) {
+                commandLine.matchingMode = ListingPartitionedMatching;
+            } else {
+                return false;
+            }//if
+        } else if (("--decode-threads" == option) || ("--normalize-threads" == option)) {
+            unsigned int &stageThreads = ("--decode-threads" == option) ? commandLine.decodeThreads : commandLine.normalizeThreads;
+            try {
+                stageThreads = boost::lexical_cast<unsigned int>(argv[argPos + 1]);
+            } catch (boost::bad_lexical_cast &) {
+                return false;
+            }//try
+        } else {
+            return false;
+        }//if
+
+        argPos += 2;
+    }//while
+
+    //An incremental run needs the files to find what's new in them
+    if ((commandLine.stateFileName.empty() == false) && (commandLine.loadSnapshotFileName.empty() == false)) {
+        return false;
+    }//if
+
+    int numFileNames = commandLine.loadSnapshotFileName.empty() ? 2 : 0;
+    if (argc - argPos != numFileNames + 1) {
+        return false;
+    }//if
+
+    if (numFileNames != 0) {
+        commandLine.listingFileName = argv[argPos++];
+        commandLine.productFileName = argv[argPos++];
+    }//if
+
+    try {
+        commandLine.numThreads = boost::lexical_cast<unsigned int>(argv[argPos]);
+    } catch (boost::bad_lexical_cast &) {
+        return false;
+    }//try
+
+    return true;
+}//parseCommandLine
+
 }//anonymous namespace
 
 int main(int argc, const char* argv[])
 {
-    if (argc != 4) {
-        std::cout << "Usage: " << argv[0] << " <listings.txt> <products.txt> <numThreads>" << std::endl;
+    CommandLine commandLine;
+    if (parseCommandLine(argc, argv, commandLine) == false) {
+        printUsage(argv[0]);
         return -1;
     }//if
 
-    unsigned int numThreads = boost::lexical_cast<unsigned int>(argv[3]);
+    unsigned int numThreads = commandLine.numThreads;
 
-    std::ifstream listingFile(argv[1]);
-    std::ifstream productFile(argv[2]);
+    IngestOptions ingestOptions(numThreads);
+    if (commandLine.decodeThreads != 0) {
+        ingestOptions.decodeThreads = commandLine.decodeThreads;
+    }//if
+    if (commandLine.normalizeThreads != 0) {
+        ingestOptions.normalizeThreads = commandLine.normalizeThreads;
+    }//if
 
     Datas datas;
-    
-    //Soak up the listing data
-    std::string inLine;
-    while (std::getline(listingFile, inLine)) {
-        if (inLine.length() == 0) {
-            continue;
+    datas.normalizedFields = adhocMatchingFields(); //Only what the matcher reads gets normalized
+    SnapshotSource source;
+    std::tr1::shared_ptr<ProductStack> productStack; //Set up during the import, unless starting from a snapshot
+    unsigned int firstNewListing = 0;
+    if (commandLine.loadSnapshotFileName.empty() == false) {
+        std::string errorMessage;
+        if (loadSnapshot(datas, commandLine.loadSnapshotFileName, false, boost::bind(&normalizeListingFields, boost::ref(datas), _1, _2),
+                         boost::bind(&normalizeProductFields, boost::ref(datas), _1, _2), source, errorMessage) == false) {
+            std::cout << "Failed to load snapshot '" << commandLine.loadSnapshotFileName << "': " << errorMessage << std::endl;
+            return -1;
         }//if
-
-        Json::Value listingRoot;
-        Json::Reader listingReader;
-        bool parsingSuccessful = listingReader.parse(inLine, listingRoot);
-        if (false == parsingSuccessful) {
-            // report to the user the failure and their locations in the document.
-            std::cout  << "Failed to parse listing configuration" << std::endl << listingReader.getFormattedErrorMessages();
-            std::cout << "line was: '" << inLine << "'" << std::endl;
+    } else {
+        MappedFile listingFile;
+        MappedFile productFile;
+        if (openCorpusFiles(commandLine.listingFileName, commandLine.productFileName, listingFile, productFile) == false) {
             return -1;
         }//if
 
-        importListing(datas, listingRoot);
-    }//while
-
-    //Soak up the product data
-    while (std::getline(productFile, inLine)) {
-        if (inLine.length() == 0) {
-            continue;
+        bool imported;
+        if (commandLine.stateFileName.empty() == false) {
+            imported = importIncremental(datas, commandLine.stateFileName, listingFile, productFile, ingestOptions, productStack, firstNewListing);
+        } else {
+            imported = importCorpus(datas, listingFile, productFile, ingestOptions, productStack);
         }//if
 
-        Json::Value productRoot;
-        Json::Reader productReader;
-        bool parsingSuccessful = productReader.parse(inLine, productRoot);
-        if (false == parsingSuccessful) {
-            // report to the user the failure and their locations in the document.
-            std::cout  << "Failed to parse product configuration" << std::endl << productReader.getFormattedErrorMessages();
-            std::cout << "line was: '" << inLine << "'" << std::endl;
+        if (false == imported) {
             return -1;
         }//if
 
-        importProduct(datas, productRoot);
-    }//while
+        source.describe(listingFile, productFile);
+    }//if
+
+    if (commandLine.writeSnapshotFileName.empty() == false) {
+        std::string errorMessage;
+        if (writeSnapshot(datas, commandLine.writeSnapshotFileName, source, false, errorMessage) == false) {
+            std::cout << "Failed to write snapshot '" << commandLine.writeSnapshotFileName << "': " << errorMessage << std::endl;
+            return -1;
+        }//if
+    }//if
 
     //dumpData(datas); -- for debugging
 
+    if (productStack == NULL) {
+        productStack = prepareAdhocProducts(datas);
+    }//if
+
+    //Done with importing; the cached values aren't needed any more
+    datas.normalizeCache.clear();
+
+    //Nothing more gets added to the string table; the matching threads share it read only
+    datas.stringTable.freeze();
+
     //Start the magic happening
-    doAdhocMatching(datas, numThreads);
+    doAdhocMatching(datas, productStack, numThreads, firstNewListing, commandLine.matchingMode);
+
+    //The next incremental run carries on from here
+    if (commandLine.stateFileName.empty() == false) {
+        std::string errorMessage;
+        if (writeSnapshot(datas, commandLine.stateFileName, source, true, errorMessage) == false) {
+            std::cout << "Failed to write state '" << commandLine.stateFileName << "': " << errorMessage << std::endl;
+            return -1;
+        }//if
+    }//if
+
     outputResults(datas);
 
     //outputResultsFormatted(datas); -- for debugging
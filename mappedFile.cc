@@ -0,0 +1,101 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie                              
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+
+#include "mappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile()
+{
+    data = NULL;
+    dataSize = 0;
+}//constructor
+
+MappedFile::~MappedFile()
+{
+    close();
+}//destructor
+
+//Map the whole file read-only. An empty file is fine and simply has no lines.
+bool MappedFile::open(const char *fileName)
+{
+    close();
+
+    int fd = ::open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }//if
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        return false;
+    }//if
+
+    if (fileStat.st_size == 0) {
+        ::close(fd);
+        return true;
+    }//if
+
+    void *mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); //the mapping keeps its own reference to the file
+
+    if (MAP_FAILED == mapping) {
+        return false;
+    }//if
+
+    //We only ever walk the file front to back
+    madvise(mapping, fileStat.st_size, MADV_SEQUENTIAL);
+
+    data = static_cast<const char *>(mapping);
+    dataSize = fileStat.st_size;
+
+    return true;
+}//open
+
+void MappedFile::close()
+{
+    if (data != NULL) {
+        munmap(const_cast<char *>(data), dataSize);
+    }//if
+
+    data = NULL;
+    dataSize = 0;
+}//close
+
+//Number of lines in the file (a trailing line without a newline still counts).
+//Used to size the containers up front, so blank lines being included doesn't matter.
+unsigned int MappedFile::countLines() const
+{
+    unsigned int numLines = 0;
+
+    const char *pos = begin();
+    const char *lineBegin;
+    const char *lineEnd;
+    while (nextLine(pos, end(), lineBegin, lineEnd) == true) {
+        ++numLines;
+    }//while
+
+    return numLines;
+}//countLines
+
+//madvise() wants a page aligned start, so the range is widened to the page holding rangeBegin
+void MappedFile::willNeed(const char *rangeBegin, const char *rangeEnd) const
+{
+    if ((NULL == data) || (rangeBegin >= rangeEnd)) {
+        return;
+    }//if
+
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const char *pageBegin = data + ((rangeBegin - data) / pageSize) * pageSize;
+    madvise(const_cast<char *>(pageBegin), rangeEnd - pageBegin, MADV_WILLNEED);
+}//willNeed
+
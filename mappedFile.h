@@ -0,0 +1,65 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie                              
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __MAPPEDFILE_H
+#define __MAPPEDFILE_H
+
+#include <cstring>
+#include <cstddef>
+
+//A read-only memory mapping of an entire file. Lines are found in place so the
+//parser can be handed pointers straight into the mapping without any copies.
+class MappedFile
+{
+    const char *data;
+    size_t dataSize;
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char *fileName);
+    void close();
+
+    const char *begin() const { return data; }
+    const char *end() const { return data + dataSize; }
+    size_t size() const { return dataSize; }
+
+    unsigned int countLines() const;
+
+    //Hint that [rangeBegin, rangeEnd) is about to be read, so the kernel can start paging it in
+    void willNeed(const char *rangeBegin, const char *rangeEnd) const;
+};//MappedFile
+
+//Grab the next line out of [pos, end) as [lineBegin, lineEnd) (without the newline) and
+//move pos past it. Returns false once there is nothing left.
+inline bool nextLine(const char *&pos, const char *end, const char *&lineBegin, const char *&lineEnd)
+{
+    if (pos >= end) {
+        return false;
+    }//if
+
+    lineBegin = pos;
+
+    const char *newLine = static_cast<const char *>(memchr(pos, '\n', end - pos));
+    if (newLine != NULL) {
+        lineEnd = newLine;
+        pos = newLine + 1;
+    } else {
+        lineEnd = end;
+        pos = end;
+    }//if
+
+    return true;
+}//nextLine
+
+#endif
+
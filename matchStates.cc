@@ -0,0 +1,46 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#include "matchStates.h"
+#include <stdlib.h>
+#include <new>
+
+MatchStates::~MatchStates()
+{
+    free(matches);
+}//destructor
+
+//Make room for numListings listings. The ones already there keep their matches; the new ones have none.
+void MatchStates::resize(unsigned int numListings_)
+{
+    if (numListings_ == numListings) {
+        return;
+    }//if
+
+    //Whole cache lines, starting on a cache line
+    size_t numLines = (numListings_ + listingsPerCacheLine - 1) / listingsPerCacheLine;
+    void *newMatches = NULL;
+    if (posix_memalign(&newMatches, cacheLineSize, (numLines == 0 ? 1 : numLines) * cacheLineSize) != 0) {
+        throw std::bad_alloc();
+    }//if
+
+    unsigned int numKept = (numListings_ < numListings) ? numListings_ : numListings;
+    if (numKept != 0) {
+        memcpy(newMatches, matches, numKept * sizeof(uint64_t));
+    }//if
+
+    free(matches);
+    matches = static_cast<uint64_t *>(newMatches);
+
+    uint64_t noMatch = packMatch(noProduct, -99999.0f);
+    for (unsigned int listingIndex = numKept; listingIndex < numListings_; ++listingIndex) {
+        matches[listingIndex] = noMatch;
+    }//for
+
+    numListings = numListings_;
+}//resize
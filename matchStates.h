@@ -0,0 +1,106 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __MATCHSTATES_H
+#define __MATCHSTATES_H
+
+#include <stdint.h>
+#include <string.h>
+
+//The best match found so far for every listing, indexed like the listings in Datas. This is the only
+//thing the matching threads write, so it's kept apart from everything they read (the listings and the
+//ListingCorpus), in its own cache line aligned block: updating a match never invalidates a line
+//another thread is reading tokens from.
+//
+//Each listing's match is one word, so the threads can update it without a lock: the weight in the
+//high half, encoded so that comparing words compares weights, and the product's index in Datas in
+//the low half (noProduct if nothing has matched).
+class MatchStates
+{
+    uint64_t *matches;
+    unsigned int numListings;
+
+    MatchStates(const MatchStates &);
+    MatchStates &operator=(const MatchStates &);
+
+    //Flip a float's bits around so that they order the same way as the floats do
+    static uint32_t encodeWeight(float weight)
+    {
+        if (0.0f == weight) {
+            weight = 0.0f; //-0 and 0 are the same weight
+        }//if
+
+        uint32_t bits;
+        memcpy(&bits, &weight, sizeof(bits));
+        return ((bits & 0x80000000) != 0) ? ~bits : bits | 0x80000000;
+    }//encodeWeight
+
+    static float decodeWeight(uint32_t bits)
+    {
+        bits = ((bits & 0x80000000) != 0) ? bits & 0x7fffffff : ~bits;
+
+        float weight;
+        memcpy(&weight, &bits, sizeof(weight));
+        return weight;
+    }//decodeWeight
+
+    static uint64_t packMatch(unsigned int productIndex, float weight) { return ((uint64_t)encodeWeight(weight) << 32) | productIndex; }
+
+public:
+    static const unsigned int noProduct = 0xffffffff;
+    static const unsigned int cacheLineSize = 64;
+    static const unsigned int listingsPerCacheLine = cacheLineSize / sizeof(uint64_t);
+
+    MatchStates() : matches(NULL), numListings(0) {}
+    ~MatchStates();
+
+    //Make room for numListings listings. The ones already there keep their matches; the new ones have none.
+    void resize(unsigned int numListings_);
+
+    unsigned int getNumListings() const { return numListings; }
+
+    unsigned int getBestMatchedProduct(unsigned int listingIndex) const { return (uint32_t)matches[listingIndex]; }
+    float getBestMatchedWeight(unsigned int listingIndex) const { return decodeWeight(matches[listingIndex] >> 32); }
+
+    //Not for while the matching threads are running, see offerMatch
+    void setBestMatch(unsigned int listingIndex, unsigned int productIndex, float weight) { matches[listingIndex] = packMatch(productIndex, weight); }
+
+    //Make productIndex the listing's best match if weight beats the best so far. Any number of threads
+    //can offer matches at once. Of two products with the same weight, the one with the higher index
+    //wins, whichever order they're offered in. Returns whether the match was taken.
+    bool offerMatch(unsigned int listingIndex, unsigned int productIndex, float weight)
+    {
+        uint64_t offeredMatch = packMatch(productIndex, weight);
+
+        uint64_t curMatch = __atomic_load_n(&matches[listingIndex], __ATOMIC_RELAXED);
+        while (offeredMatch > curMatch) {
+            uint64_t seenMatch = __sync_val_compare_and_swap(&matches[listingIndex], curMatch, offeredMatch);
+            if (seenMatch == curMatch) {
+                return true;
+            }//if
+
+            curMatch = seenMatch;
+        }//while
+
+        return false;
+    }//offerMatch
+
+    //Same as offerMatch, for when no other thread can be updating the listing's match
+    bool offerOwnedMatch(unsigned int listingIndex, unsigned int productIndex, float weight)
+    {
+        uint64_t offeredMatch = packMatch(productIndex, weight);
+        if (offeredMatch > matches[listingIndex]) {
+            matches[listingIndex] = offeredMatch;
+            return true;
+        }//if
+
+        return false;
+    }//offerOwnedMatch
+};//MatchStates
+
+#endif
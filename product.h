@@ -13,8 +13,7 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 #include <string>
 #include <vector>
 #include <tr1/memory>
-
-struct Listing;
+#include <stdexcept>
 
 //Represents a product
 class Product
@@ -31,20 +30,38 @@ class Product
     std::vector<unsigned int> model;
     std::vector<unsigned int> announcedDate;
 
-    std::vector<std::tr1::shared_ptr<Listing> > matchedListings;
+    std::vector<unsigned int> matchedListings; //indices in Datas
+
+    unsigned int normalizedFields; //Field bits of the fields whose tokens have been set
+
+    //A field that was never normalized has no tokens, so anything reading it would silently match against nothing
+    void checkNormalized(unsigned int field) const
+    {
+        if ((normalizedFields & field) == 0) {
+            throw std::logic_error("Product field was never normalized, see FieldSet");
+        }//if
+    }//checkNormalized
 
 public:    
+    //The normalized fields, as bits for saying which of them are normalized (see FieldSet in datas.h)
+    enum Field { ProductNameField = 1, ManufacturerField = 2, FamilyField = 4, ModelField = 8, AnnouncedDateField = 16 };
+
+    Product() : normalizedFields(0) {}
+
+    bool isNormalized(Field field) const { return (normalizedFields & field) != 0; }
+
     std::string &getProductNameBase() { return productNameBase; }
     std::string &getManufacturerBase() { return manufacturerBase; }
     std::string &getFamilyBase() { return familyBase; }
     std::string &getModelBase() { return modelBase; }
     std::string &getAnnouncedDateBase() { return announcedDateBase; }
 
-    std::vector<unsigned int> &getProductName() { return productName; }
-    std::vector<unsigned int> &getManufacturer() { return manufacturer; }
-    std::vector<unsigned int> &getFamily() { return family; }
-    std::vector<unsigned int> &getModel() { return model; }
-    std::vector<unsigned int> &getAnnouncedDate() { return announcedDate; }
+    //Only for normalized fields, throws std::logic_error for the others
+    std::vector<unsigned int> &getProductName() { checkNormalized(ProductNameField); return productName; }
+    std::vector<unsigned int> &getManufacturer() { checkNormalized(ManufacturerField); return manufacturer; }
+    std::vector<unsigned int> &getFamily() { checkNormalized(FamilyField); return family; }
+    std::vector<unsigned int> &getModel() { checkNormalized(ModelField); return model; }
+    std::vector<unsigned int> &getAnnouncedDate() { checkNormalized(AnnouncedDateField); return announcedDate; }
 
     void setProductNameBase(const std::string &str) { productNameBase = str; }
     void setManufacturerBase(const std::string &str) { manufacturerBase = str; }
@@ -52,18 +69,24 @@ public:
     void setModelBase(const std::string &str) { modelBase = str; }
     void setAnnouncedDateBase(const std::string &str) { announcedDateBase = str; }
 
-    void setProductName(std::vector<unsigned int> vec) { productName = vec; }
-    void setManufacturer(std::vector<unsigned int> vec) { manufacturer = vec; }
-    void setFamily(std::vector<unsigned int> vec) { family = vec; }
-    void setModel(std::vector<unsigned int> vec) { model = vec; }
-    void setAnnouncedDate(std::vector<unsigned int> vec) { announcedDate = vec; }
+    void setProductNameBase(const char *begin, const char *end) { productNameBase.assign(begin, end); }
+    void setManufacturerBase(const char *begin, const char *end) { manufacturerBase.assign(begin, end); }
+    void setFamilyBase(const char *begin, const char *end) { familyBase.assign(begin, end); }
+    void setModelBase(const char *begin, const char *end) { modelBase.assign(begin, end); }
+    void setAnnouncedDateBase(const char *begin, const char *end) { announcedDateBase.assign(begin, end); }
+
+    void setProductName(std::vector<unsigned int> vec) { productName = vec; normalizedFields |= ProductNameField; }
+    void setManufacturer(std::vector<unsigned int> vec) { manufacturer = vec; normalizedFields |= ManufacturerField; }
+    void setFamily(std::vector<unsigned int> vec) { family = vec; normalizedFields |= FamilyField; }
+    void setModel(std::vector<unsigned int> vec) { model = vec; normalizedFields |= ModelField; }
+    void setAnnouncedDate(std::vector<unsigned int> vec) { announcedDate = vec; normalizedFields |= AnnouncedDateField; }
 
-    std::pair<std::vector<std::tr1::shared_ptr<Listing> >::iterator, std::vector<std::tr1::shared_ptr<Listing> >::iterator> getMatchedListingPair()
+    std::pair<std::vector<unsigned int>::iterator, std::vector<unsigned int>::iterator> getMatchedListingPair()
     {
         return std::make_pair(matchedListings.begin(), matchedListings.end());
     }//getMatchedListingPair
 
-    void addMatchedListing(std::tr1::shared_ptr<Listing> listing) { matchedListings.push_back(listing); }
+    void addMatchedListing(unsigned int listingIndex) { matchedListings.push_back(listingIndex); }
 
     void dump();
 };//Product
@@ -0,0 +1,137 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __RECORDDECODER_H
+#define __RECORDDECODER_H
+
+#include <cstddef>
+#include <json/json.h>
+
+//Compares a key against a compile-time list of characters, one character at a time
+template <char... Chars>
+struct KeyChars;
+
+template <>
+struct KeyChars<>
+{
+    static bool equal(const char *) { return true; }
+};//KeyChars
+
+template <char First, char... Rest>
+struct KeyChars<First, Rest...>
+{
+    static bool equal(const char *key) { return (First == *key) && KeyChars<Rest...>::equal(key + 1); }
+};//KeyChars
+
+//A single field of a flat JSON record: its key, spelled out as characters, and the setter which
+//receives the value as a [begin, end) range.
+//eg. RecordField<Listing, &Listing::setTitleBase, 't','i','t','l','e'>
+template <class Record, void (Record::*Setter)(const char *, const char *), char First, char... Rest>
+struct RecordField
+{
+    typedef void (Record::*SetterType)(const char *, const char *);
+
+    //Length and first byte are checked first so most mismatches cost two compares
+    static bool matches(const char *key, size_t keyLength)
+    {
+        return (keyLength == sizeof...(Rest) + 1) && (First == key[0]) && KeyChars<Rest...>::equal(key + 1);
+    }//matches
+
+    static SetterType setter() { return Setter; }
+};//RecordField
+
+//Finds the setter for a key among a list of fields. Fully unrolled at compile time.
+template <class Record, class... Fields>
+struct RecordFieldLookup;
+
+template <class Record>
+struct RecordFieldLookup<Record>
+{
+    static void (Record::*find(const char *, size_t))(const char *, const char *) { return NULL; }
+};//RecordFieldLookup
+
+template <class Record, class Field, class... Rest>
+struct RecordFieldLookup<Record, Field, Rest...>
+{
+    static void (Record::*find(const char *key, size_t keyLength))(const char *, const char *)
+    {
+        if (Field::matches(key, keyLength) == true) {
+            return Field::setter();
+        }//if
+
+        return RecordFieldLookup<Record, Rest...>::find(key, keyLength);
+    }//find
+};//RecordFieldLookup
+
+//Decodes one JSON record straight into a Record via the setters of its fields. Values of keys
+//which aren't fields (and anything nested) are skipped by the reader without being decoded.
+//Numbers and booleans are handed over as their text, null as "".
+template <class Record, class... Fields>
+class RecordDecoder : public Json::ReaderHandler
+{
+    typedef void (Record::*SetterType)(const char *, const char *);
+
+    Record *record;
+    SetterType currentSetter;
+    int depth;
+
+    void setValue(const char *begin, const char *end)
+    {
+        if (currentSetter != NULL) {
+            (record->*currentSetter)(begin, end);
+            currentSetter = NULL;
+        }//if
+    }//setValue
+
+public:
+    RecordDecoder() : record(NULL), currentSetter(NULL), depth(0) {}
+
+    //Parse [begin, end) into newRecord. On failure reader has the error messages.
+    bool decode(Json::Reader &reader, const char *begin, const char *end, Record &newRecord)
+    {
+        record = &newRecord;
+        currentSetter = NULL;
+        depth = 0;
+
+        return reader.parse(begin, end, *this);
+    }//decode
+
+    virtual bool startObject() { ++depth; currentSetter = NULL; return true; }
+    virtual bool endObject() { --depth; return true; }
+    virtual bool startArray() { ++depth; currentSetter = NULL; return true; }
+    virtual bool endArray() { --depth; return true; }
+
+    virtual bool key(const char *begin, const char *end)
+    {
+        currentSetter = (1 == depth) ? RecordFieldLookup<Record, Fields...>::find(begin, end - begin) : NULL;
+
+        if (NULL == currentSetter) {
+            skipValue();
+        }//if
+
+        return true;
+    }//key
+
+    virtual bool string(const char *begin, const char *end) { setValue(begin, end); return true; }
+    virtual bool number(const char *begin, const char *end) { setValue(begin, end); return true; }
+    virtual bool null() { setValue("", ""); return true; }
+
+    virtual bool boolean(bool value)
+    {
+        if (true == value) {
+            setValue("true", "true" + 4);
+        } else {
+            setValue("false", "false" + 5);
+        }//if
+
+        return true;
+    }//boolean
+};//RecordDecoder
+
+#endif
+
@@ -0,0 +1,483 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+
+#include "snapshot.h"
+#include "listing.h"
+#include "product.h"
+#include "mappedFile.h"
+#include <stdint.h>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+namespace
+{
+
+//Bump whenever the layout below changes
+const uint32_t snapshotVersion = 3;
+const char snapshotMagic[8] = {'S', 'N', 'A', 'P', 'C', 'O', 'R', 'P'};
+
+//Stored as is, so a snapshot written on a machine with the other byte order is refused
+const uint32_t snapshotByteOrderMark = 0x01020304;
+
+const unsigned int numListingFields = 4; //title, manufacturer, currency, price
+const unsigned int numProductFields = 5; //product name, manufacturer, family, model, announced date
+
+//Marks a listing without a matched product
+const uint32_t noMatchedProduct = 0xffffffff;
+
+//How much of the end of the listings read is hashed to recognise the file again
+const size_t listingsTailHashSize = 4096;
+
+//Layout of a snapshot, everything in native byte order and each part 4 byte aligned:
+//
+//  SnapshotHeader
+//  SnapshotText[numStrings]                        the string table, indexed by key
+//  SnapshotField[numListings * numListingFields]
+//  SnapshotField[numProducts * numProductFields]
+//  SnapshotMatch[numListings]                      only if hasMatches
+//  uint32_t[numTokens]                             every token array, back to back
+//  char[textSize]                                  every string, back to back
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t numStrings;
+    uint32_t numListings;
+    uint32_t numProducts;
+    uint32_t numTokens;
+    uint32_t textSize;
+    uint32_t hasMatches;
+    uint32_t listingFields; //Listing::Field bits of the fields stored with tokens, the others have none
+    uint32_t productFields; //Same, as Product::Field bits
+    SnapshotSource source;
+};//SnapshotHeader
+
+//A string, as a range of the text part
+struct SnapshotText
+{
+    uint32_t offset;
+    uint32_t length;
+};//SnapshotText
+
+//A raw field and its normalized token ids
+struct SnapshotField
+{
+    SnapshotText base;
+    uint32_t tokenOffset;
+    uint32_t tokenCount;
+};//SnapshotField
+
+//The best matched product of a listing, by its position in the products
+struct SnapshotMatch
+{
+    uint32_t productIndex;
+    float weight;
+};//SnapshotMatch
+
+//64 bit FNV-1a
+uint64_t hashBytes(const char *begin, const char *end)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *pos = begin; pos != end; ++pos) {
+        hash = (hash ^ (unsigned char)*pos) * 1099511628211ULL;
+    }//for
+
+    return hash;
+}//hashBytes
+
+uint64_t hashListingsTail(const MappedFile &listingFile, uint64_t listingsSize)
+{
+    const char *tailEnd = listingFile.begin() + listingsSize;
+    return hashBytes(tailEnd - std::min<uint64_t>(listingsSize, listingsTailHashSize), tailEnd);
+}//hashListingsTail
+
+//Gathers the parts of a snapshot in memory while the corpus is walked
+class SnapshotBuilder
+{
+    std::vector<SnapshotText> strings;
+    std::vector<SnapshotField> fields;
+    std::vector<SnapshotMatch> matches;
+    std::vector<uint32_t> tokens;
+    std::string text;
+
+    SnapshotText addText(const std::string &str)
+    {
+        SnapshotText snapshotText;
+        snapshotText.offset = text.size();
+        snapshotText.length = str.size();
+        text += str;
+
+        return snapshotText;
+    }//addText
+
+public:
+    void addString(const std::string &str) { strings.push_back(addText(str)); }
+
+    void addField(const std::string &base, const unsigned int *normalizedBegin, const unsigned int *normalizedEnd)
+    {
+        SnapshotField field;
+        field.base = addText(base);
+        field.tokenOffset = tokens.size();
+        field.tokenCount = normalizedEnd - normalizedBegin;
+        tokens.insert(tokens.end(), normalizedBegin, normalizedEnd);
+
+        fields.push_back(field);
+    }//addField
+
+    void addField(const std::string &base, const std::vector<unsigned int> &normalized)
+    {
+        addField(base, normalized.data(), normalized.data() + normalized.size());
+    }//addField
+
+    //A listing field kept in the corpus
+    void addField(const std::string &base, const TokenColumn &column, unsigned int row)
+    {
+        addField(base, column.rowBegin(row), column.rowEnd(row));
+    }//addField
+
+    void addMatch(uint32_t productIndex, float weight)
+    {
+        SnapshotMatch match;
+        match.productIndex = productIndex;
+        match.weight = weight;
+        matches.push_back(match);
+    }//addMatch
+
+    bool fitsOffsets() const
+    {
+        return (text.size() <= std::numeric_limits<uint32_t>::max()) && (tokens.size() <= std::numeric_limits<uint32_t>::max());
+    }//fitsOffsets
+
+    void write(std::ofstream &outFile, SnapshotHeader &header) const
+    {
+        header.numStrings = strings.size();
+        header.numTokens = tokens.size();
+        header.textSize = text.size();
+
+        outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        outFile.write(reinterpret_cast<const char *>(strings.data()), strings.size() * sizeof(SnapshotText));
+        outFile.write(reinterpret_cast<const char *>(fields.data()), fields.size() * sizeof(SnapshotField));
+        outFile.write(reinterpret_cast<const char *>(matches.data()), matches.size() * sizeof(SnapshotMatch));
+        outFile.write(reinterpret_cast<const char *>(tokens.data()), tokens.size() * sizeof(uint32_t));
+        outFile.write(text.data(), text.size());
+    }//write
+};//SnapshotBuilder
+
+//The parts of a mapped snapshot
+struct SnapshotView
+{
+    const SnapshotHeader *header;
+    const SnapshotText *strings;
+    const SnapshotField *listingFields;
+    const SnapshotField *productFields;
+    const SnapshotMatch *matches; //NULL if the snapshot has none
+    const uint32_t *tokens;
+    const char *text;
+
+    bool isValid(const SnapshotText &snapshotText) const
+    {
+        return snapshotText.offset <= header->textSize && snapshotText.length <= header->textSize - snapshotText.offset;
+    }//isValid
+
+    bool isValid(const SnapshotField &field) const
+    {
+        return isValid(field.base) && field.tokenOffset <= header->numTokens && field.tokenCount <= header->numTokens - field.tokenOffset;
+    }//isValid
+
+    std::string getText(const SnapshotText &snapshotText) const
+    {
+        return std::string(text + snapshotText.offset, snapshotText.length);
+    }//getText
+
+    std::vector<unsigned int> getTokens(const SnapshotField &field) const
+    {
+        return std::vector<unsigned int>(tokens + field.tokenOffset, tokens + field.tokenOffset + field.tokenCount);
+    }//getTokens
+};//SnapshotView
+
+//Find the parts of a snapshot and check that everything in it stays inside the file
+bool mapSnapshot(const MappedFile &snapshotFile, SnapshotView &view, std::string &errorMessage)
+{
+    if (snapshotFile.size() < sizeof(SnapshotHeader)) {
+        errorMessage = "file is too short to be a snapshot";
+        return false;
+    }//if
+
+    //The mapping is page aligned, so the header and every part after it are suitably aligned
+    view.header = reinterpret_cast<const SnapshotHeader *>(snapshotFile.begin());
+    const SnapshotHeader &header = *view.header;
+
+    if (memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0) {
+        errorMessage = "not a snapshot";
+        return false;
+    }//if
+
+    if (header.byteOrderMark != snapshotByteOrderMark) {
+        errorMessage = "snapshot was written on a machine with a different byte order";
+        return false;
+    }//if
+
+    if (header.version != snapshotVersion) {
+        errorMessage = "snapshot is from an incompatible version";
+        return false;
+    }//if
+
+    uint64_t numFields = (uint64_t)header.numListings * numListingFields + (uint64_t)header.numProducts * numProductFields;
+    uint64_t numMatches = (header.hasMatches != 0) ? header.numListings : 0;
+    uint64_t expectedSize = sizeof(SnapshotHeader) + (uint64_t)header.numStrings * sizeof(SnapshotText) + numFields * sizeof(SnapshotField)
+                            + numMatches * sizeof(SnapshotMatch) + (uint64_t)header.numTokens * sizeof(uint32_t) + header.textSize;
+    if (expectedSize != snapshotFile.size()) {
+        errorMessage = "snapshot is truncated or corrupt";
+        return false;
+    }//if
+
+    view.strings = reinterpret_cast<const SnapshotText *>(view.header + 1);
+    view.listingFields = reinterpret_cast<const SnapshotField *>(view.strings + header.numStrings);
+    view.productFields = view.listingFields + (size_t)header.numListings * numListingFields;
+    const SnapshotMatch *matches = reinterpret_cast<const SnapshotMatch *>(view.listingFields + numFields);
+    view.matches = (numMatches != 0) ? matches : NULL;
+    view.tokens = reinterpret_cast<const uint32_t *>(matches + numMatches);
+    view.text = reinterpret_cast<const char *>(view.tokens + header.numTokens);
+
+    for (uint32_t key = 0; key < header.numStrings; ++key) {
+        if (view.isValid(view.strings[key]) == false) {
+            errorMessage = "snapshot string table is corrupt";
+            return false;
+        }//if
+    }//for
+
+    for (uint64_t pos = 0; pos < numFields; ++pos) {
+        if (view.isValid(view.listingFields[pos]) == false) {
+            errorMessage = "snapshot listing or product is corrupt";
+            return false;
+        }//if
+    }//for
+
+    for (uint64_t pos = 0; pos < numMatches; ++pos) {
+        if ((view.matches[pos].productIndex != noMatchedProduct) && (view.matches[pos].productIndex >= header.numProducts)) {
+            errorMessage = "snapshot matches are corrupt";
+            return false;
+        }//if
+    }//for
+
+    return true;
+}//mapSnapshot
+
+//What's written for a field that was never normalized; the header's field masks leave it out
+const std::vector<unsigned int> noTokens;
+
+}//anonymous namespace
+
+void SnapshotSource::describe(const MappedFile &listingFile, const MappedFile &productFile)
+{
+    listingsSize = listingFile.size();
+    listingsTailHash = hashListingsTail(listingFile, listingsSize);
+    productsSize = productFile.size();
+    productsHash = hashBytes(productFile.begin(), productFile.end());
+}//describe
+
+//Only the tail of what was read of the listings file is checked, so this costs the same however
+//long the file has grown
+bool SnapshotSource::isAppendedBy(const MappedFile &listingFile, const MappedFile &productFile) const
+{
+    if ((listingFile.size() < listingsSize) || (hashListingsTail(listingFile, listingsSize) != listingsTailHash)) {
+        return false;
+    }//if
+
+    return (productFile.size() == productsSize) && (hashBytes(productFile.begin(), productFile.end()) == productsHash);
+}//isAppendedBy
+
+//Save the listings, products and string table held in datas. Token ids are stored as they are,
+//so the string table is saved key for key.
+bool writeSnapshot(Datas &datas, const std::string &fileName, const SnapshotSource &source, bool saveMatches, std::string &errorMessage)
+{
+    SnapshotBuilder builder;
+    SnapshotHeader header = SnapshotHeader();
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.byteOrderMark = snapshotByteOrderMark;
+    header.hasMatches = (true == saveMatches) ? 1 : 0;
+    header.listingFields = datas.normalizedFields.listingFields;
+    header.productFields = datas.normalizedFields.productFields;
+    header.source = source;
+
+    unsigned int maxKey = datas.stringTable.getMaxStringVal();
+    for (unsigned int key = 0; key <= maxKey; ++key) {
+        builder.addString(datas.stringTable.getString(key));
+    }//for
+
+    //The title and manufacturer tokens only live in the corpus once the listings are in Datas
+    for (unsigned int listingIndex = 0; listingIndex < datas.getNumListings(); ++listingIndex) {
+        const Listing &listing = *datas.getListing(listingIndex);
+        builder.addField(listing.getTitleBase(), datas.listingCorpus.getTitles(), listingIndex);
+        builder.addField(listing.getManufacturerBase(), datas.listingCorpus.getManufacturers(), listingIndex);
+        builder.addField(listing.getCurrencyBase(), listing.isNormalized(Listing::CurrencyField) ? listing.getCurrency() : noTokens);
+        builder.addField(listing.getPriceBase(), listing.isNormalized(Listing::PriceField) ? listing.getPrice() : noTokens);
+        ++header.numListings;
+    }//for
+
+    BOOST_FOREACH (std::tr1::shared_ptr<Product> product, datas.getProductPair()) {
+        builder.addField(product->getProductNameBase(), product->isNormalized(Product::ProductNameField) ? product->getProductName() : noTokens);
+        builder.addField(product->getManufacturerBase(), product->isNormalized(Product::ManufacturerField) ? product->getManufacturer() : noTokens);
+        builder.addField(product->getFamilyBase(), product->isNormalized(Product::FamilyField) ? product->getFamily() : noTokens);
+        builder.addField(product->getModelBase(), product->isNormalized(Product::ModelField) ? product->getModel() : noTokens);
+        builder.addField(product->getAnnouncedDateBase(), product->isNormalized(Product::AnnouncedDateField) ? product->getAnnouncedDate() : noTokens);
+        ++header.numProducts;
+    }//foreach
+
+    if (true == saveMatches) {
+        datas.matchStates.resize(datas.getNumListings());
+        for (unsigned int listingIndex = 0; listingIndex < datas.getNumListings(); ++listingIndex) {
+            unsigned int productIndex = datas.matchStates.getBestMatchedProduct(listingIndex);
+            builder.addMatch((productIndex != MatchStates::noProduct) ? productIndex : noMatchedProduct, datas.matchStates.getBestMatchedWeight(listingIndex));
+        }//for
+    }//if
+
+    if (builder.fitsOffsets() == false) {
+        errorMessage = "corpus is too large for a snapshot";
+        return false;
+    }//if
+
+    std::ofstream outFile(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (outFile.is_open() == false) {
+        errorMessage = "can't create file";
+        return false;
+    }//if
+
+    builder.write(outFile, header);
+    outFile.close();
+
+    if (outFile.fail() == true) {
+        errorMessage = "failed writing file";
+        return false;
+    }//if
+
+    return true;
+}//writeSnapshot
+
+//Check a snapshot and get its source without loading anything
+bool readSnapshotSource(const std::string &fileName, SnapshotSource &source, bool &hasMatches, std::string &errorMessage)
+{
+    MappedFile snapshotFile;
+    if (snapshotFile.open(fileName.c_str()) == false) {
+        errorMessage = "can't open file";
+        return false;
+    }//if
+
+    SnapshotView view;
+    if (mapSnapshot(snapshotFile, view, errorMessage) == false) {
+        return false;
+    }//if
+
+    source = view.header->source;
+    hasMatches = (view.matches != NULL);
+
+    return true;
+}//readSnapshotSource
+
+//Fill an empty datas with the listings, products and string table saved in a snapshot.
+//The file is mapped and copied straight out of, nothing gets parsed or normalized.
+bool loadSnapshot(Datas &datas, const std::string &fileName, bool restoreMatches, const ListingNormalizer &normalizeListing,
+                  const ProductNormalizer &normalizeProduct, SnapshotSource &source, std::string &errorMessage)
+{
+    MappedFile snapshotFile;
+    if (snapshotFile.open(fileName.c_str()) == false) {
+        errorMessage = "can't open file";
+        return false;
+    }//if
+
+    SnapshotView view;
+    if (mapSnapshot(snapshotFile, view, errorMessage) == false) {
+        return false;
+    }//if
+
+    //Keys 0 and 1 are never handed out for anything but ""
+    for (uint32_t key = 0; key < view.header->numStrings; ++key) {
+        if (view.strings[key].length != 0) {
+            datas.stringTable.restoreString(key, view.getText(view.strings[key]));
+        }//if
+    }//for
+
+    //The fields this run normalizes take their tokens from the snapshot if it has them, and are
+    //normalized from the raw text if it doesn't
+    unsigned int listingFields = datas.normalizedFields.listingFields & view.header->listingFields;
+    unsigned int productFields = datas.normalizedFields.productFields & view.header->productFields;
+    unsigned int missingListingFields = datas.normalizedFields.listingFields & ~view.header->listingFields;
+    unsigned int missingProductFields = datas.normalizedFields.productFields & ~view.header->productFields;
+
+    datas.reserveListings(view.header->numListings);
+    const SnapshotField *field = view.listingFields;
+    for (uint32_t pos = 0; pos < view.header->numListings; ++pos, field += numListingFields) {
+        std::tr1::shared_ptr<Listing> listing(new Listing);
+        listing->setTitleBase(view.getText(field[0].base));
+        if ((listingFields & Listing::TitleField) != 0) {
+            listing->setTitle(view.getTokens(field[0]));
+        }//if
+        listing->setManufacturerBase(view.getText(field[1].base));
+        if ((listingFields & Listing::ManufacturerField) != 0) {
+            listing->setManufacturer(view.getTokens(field[1]));
+        }//if
+        listing->setCurrencyBase(view.getText(field[2].base));
+        if ((listingFields & Listing::CurrencyField) != 0) {
+            listing->setCurrency(view.getTokens(field[2]));
+        }//if
+        listing->setPriceBase(view.getText(field[3].base));
+        if ((listingFields & Listing::PriceField) != 0) {
+            listing->setPrice(view.getTokens(field[3]));
+        }//if
+        normalizeListing(*listing, missingListingFields);
+        datas.addListing(listing);
+    }//for
+
+    datas.reserveProducts(view.header->numProducts);
+    field = view.productFields;
+    for (uint32_t pos = 0; pos < view.header->numProducts; ++pos, field += numProductFields) {
+        std::tr1::shared_ptr<Product> product(new Product);
+        product->setProductNameBase(view.getText(field[0].base));
+        if ((productFields & Product::ProductNameField) != 0) {
+            product->setProductName(view.getTokens(field[0]));
+        }//if
+        product->setManufacturerBase(view.getText(field[1].base));
+        if ((productFields & Product::ManufacturerField) != 0) {
+            product->setManufacturer(view.getTokens(field[1]));
+        }//if
+        product->setFamilyBase(view.getText(field[2].base));
+        if ((productFields & Product::FamilyField) != 0) {
+            product->setFamily(view.getTokens(field[2]));
+        }//if
+        product->setModelBase(view.getText(field[3].base));
+        if ((productFields & Product::ModelField) != 0) {
+            product->setModel(view.getTokens(field[3]));
+        }//if
+        product->setAnnouncedDateBase(view.getText(field[4].base));
+        if ((productFields & Product::AnnouncedDateField) != 0) {
+            product->setAnnouncedDate(view.getTokens(field[4]));
+        }//if
+        normalizeProduct(*product, missingProductFields);
+        datas.addProduct(product);
+    }//for
+
+    if ((true == restoreMatches) && (view.matches != NULL)) {
+        datas.matchStates.resize(view.header->numListings);
+        for (uint32_t pos = 0; pos < view.header->numListings; ++pos) {
+            const SnapshotMatch &match = view.matches[pos];
+            datas.matchStates.setBestMatch(pos, (match.productIndex != noMatchedProduct) ? match.productIndex : MatchStates::noProduct, match.weight);
+        }//for
+    }//if
+
+    source = view.header->source;
+
+    return true;
+}//loadSnapshot
+
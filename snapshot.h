@@ -0,0 +1,57 @@
+/*
+Snapsort-Challenge -- An answer to the Snapsort coding challenge
+Written by Chris Mennie (chris at chrismennie.ca or cmennie at rogers.com)
+Copyright (C) 2011 Chris A. Mennie
+
+License: Released under the GPL version 3 license. See the included LICENSE.
+*/
+
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include <string>
+#include <stdint.h>
+#include <boost/function.hpp>
+#include "datas.h"
+#include "mappedFile.h"
+
+//A snapshot is a binary image of the normalized corpus: the string table plus the raw fields and
+//token arrays of every listing and product. Starting from one skips parsing and normalizing
+//the JSON files, which is most of the startup time. It can also hold each listing's best match,
+//which is what lets an incremental run carry on from where the last one stopped.
+
+//What the corpus in a snapshot was read from, so a later run can tell whether its inputs have changed
+struct SnapshotSource
+{
+    uint64_t listingsSize;     //How much of the listings file was read
+    uint64_t listingsTailHash; //Hash of the last few KB of that
+    uint64_t productsSize;
+    uint64_t productsHash;     //Hash of the whole products file
+
+    SnapshotSource() : listingsSize(0), listingsTailHash(0), productsSize(0), productsHash(0) {}
+
+    void describe(const MappedFile &listingFile, const MappedFile &productFile);
+
+    //True if since then the listings file has only been appended to, and the products file is untouched
+    bool isAppendedBy(const MappedFile &listingFile, const MappedFile &productFile) const;
+};//SnapshotSource
+
+//Save the listings, products and string table held in datas, and if saveMatches is set
+//the best matched product of each listing
+bool writeSnapshot(Datas &datas, const std::string &fileName, const SnapshotSource &source, bool saveMatches, std::string &errorMessage);
+
+//Normalize the given fields of a record (a mask of Listing::Field or Product::Field)
+typedef boost::function<void (Listing &, unsigned int)> ListingNormalizer;
+typedef boost::function<void (Product &, unsigned int)> ProductNormalizer;
+
+//Fill an empty datas with the listings, products and string table saved in a snapshot. The best
+//matches are only put back if restoreMatches is set (and the snapshot has them). Fields in
+//datas.normalizedFields that the snapshot has no tokens for are normalized with the normalizers.
+bool loadSnapshot(Datas &datas, const std::string &fileName, bool restoreMatches, const ListingNormalizer &normalizeListing,
+                  const ProductNormalizer &normalizeProduct, SnapshotSource &source, std::string &errorMessage);
+
+//Check a snapshot and get its source without loading anything
+bool readSnapshotSource(const std::string &fileName, SnapshotSource &source, bool &hasMatches, std::string &errorMessage);
+
+#endif
+
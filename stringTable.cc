@@ -6,39 +6,395 @@ Copyright (C) 2011 Chris A. Mennie
 License: Released under the GPL version 3 license. See the included LICENSE.
 */
 
-
 #include "stringTable.h"
+#include <string.h>
+#include <stdexcept>
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+namespace
+{
+
+//FNV-1a, mixed so the top bits (which pick the shard) are as good as the bottom ones (which pick the slot)
+uint64_t hashChars(const char *chars, unsigned int length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned int pos = 0; pos < length; ++pos) {
+        hash = (hash ^ (unsigned char)chars[pos]) * 1099511628211ULL;
+    }//for
+
+    return (hash ^ (hash >> 29)) * 0x9e3779b97f4a7c15ULL;
+}//hashChars
+
+//Rehash a string's hash under a seed, for picking its slot in a frozen table
+uint64_t seededHash(uint64_t hash, uint64_t seed)
+{
+    hash ^= seed * 0xc2b2ae3d27d4eb4fULL;
+    hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdULL;
+    hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+    return hash ^ (hash >> 33);
+}//seededHash
+
+bool largerBucket(const std::vector<unsigned int> *first, const std::vector<unsigned int> *second)
+{
+    return first->size() > second->size();
+}//largerBucket
+
+}//anonymous namespace
 
 StringTable::StringTable()
+    : pages(maxPages, static_cast<Token *>(NULL)), nextKey(2), frozen(false), frozenSalt(0)
 {
-    table[0] = "";
+    emptyToken.chars = "";
+    emptyToken.length = 0;
+    emptyToken.hash = 0;
 }//constructor
 
+StringTable::~StringTable()
+{
+    BOOST_FOREACH (Token *page, pages) {
+        delete [] page;
+    }//foreach
+
+    for (unsigned int shardNum = 0; shardNum < numShards; ++shardNum) {
+        BOOST_FOREACH (char *arenaPage, shards[shardNum].arenaPages) {
+            delete [] arenaPage;
+        }//foreach
+    }//for
+}//destructor
+
+//Set the token for key, adding the page key is on if it isn't there yet
+void StringTable::setToken(unsigned int key, const Token &token)
+{
+    unsigned int pageNum = key >> pageBits;
+    if (pageNum >= maxPages) {
+        throw std::length_error("StringTable is full");
+    }//if
+
+    Token *page = __atomic_load_n(&pages[pageNum], __ATOMIC_ACQUIRE);
+    if (NULL == page) {
+        boost::mutex::scoped_lock lock(pageLock);
+
+        page = __atomic_load_n(&pages[pageNum], __ATOMIC_ACQUIRE);
+        if (NULL == page) {
+            page = new Token[pageSize]();
+            __atomic_store_n(&pages[pageNum], page, __ATOMIC_RELEASE);
+        }//if
+    }//if
+
+    page[key & (pageSize - 1)] = token;
+}//setToken
+
+//The slot holding the key of a string, or the empty slot it would go in
+unsigned int *StringTable::findSlot(Shard &shard, const char *chars, unsigned int length, uint64_t hash)
+{
+    size_t mask = shard.slots.size() - 1;
+    size_t slotNum = hash & mask;
+    while (shard.slots[slotNum] != 0) {
+        const Token &token = getToken(shard.slots[slotNum]);
+        if ((token.hash == (unsigned int)hash) && (token.length == length) && (memcmp(token.chars, chars, length) == 0)) {
+            break;
+        }//if
+
+        slotNum = (slotNum + 1) & mask;
+    }//while
+
+    return &shard.slots[slotNum];
+}//findSlot
+
+//Double the number of slots in a shard
+void StringTable::growSlots(Shard &shard)
+{
+    std::vector<unsigned int> oldSlots;
+    oldSlots.swap(shard.slots);
+    shard.slots.assign(oldSlots.empty() ? 64 : oldSlots.size() * 2, 0);
+
+    size_t mask = shard.slots.size() - 1;
+    BOOST_FOREACH (unsigned int key, oldSlots) {
+        if (0 == key) {
+            continue;
+        }//if
+
+        size_t slotNum = getToken(key).hash & mask;
+        while (shard.slots[slotNum] != 0) {
+            slotNum = (slotNum + 1) & mask;
+        }//while
+
+        shard.slots[slotNum] = key;
+    }//foreach
+}//growSlots
+
+//Copy a string into a shard's arena and give it key, using slot (as found by findSlot)
+void StringTable::addToShard(Shard &shard, unsigned int *slot, unsigned int key, const char *chars, unsigned int length, uint64_t hash)
+{
+    if ((NULL == shard.arenaPos) || (length > shard.arenaLeft)) {
+        size_t newPageSize = std::max(size_t(arenaPageSize), (size_t)length);
+        shard.arenaPages.push_back(new char[newPageSize]);
+        shard.arenaPos = shard.arenaPages.back();
+        shard.arenaLeft = newPageSize;
+    }//if
+
+    Token token;
+    token.chars = shard.arenaPos;
+    token.length = length;
+    token.hash = (unsigned int)hash;
+    memcpy(shard.arenaPos, chars, length);
+    shard.arenaPos += length;
+    shard.arenaLeft -= length;
+
+    setToken(key, token);
+
+    *slot = key;
+    ++shard.numKeys;
+
+    //Keep the slots at most half full
+    if (shard.numKeys * 2 > shard.slots.size()) {
+        growSlots(shard);
+    }//if
+}//addToShard
+
 //Returns the table entry for a string, adding it to the table if it wasn't already there
 unsigned int StringTable::getStringVal(const std::string &str)
 {
-    if (tableRev.find(str) != tableRev.end()) {
-        return tableRev[str];
+    if (true == frozen) {
+        unsigned int key = findStringVal(str);
+        if (0 == key) {
+            throw std::logic_error("StringTable is frozen");
+        }//if
+
+        return key;
     }//if
 
-    unsigned int newId = table.size() + 1;
-    tableRev[str] = newId;
-    table[newId] = str;
+    unsigned int length = str.size();
+    uint64_t hash = hashChars(str.data(), length);
+    Shard &shard = shards[hash >> (64 - numShardBits)];
+
+    boost::mutex::scoped_lock lock(shard.shardLock);
 
-    return newId;
+    if (shard.slots.empty() == true) {
+        growSlots(shard);
+    }//if
+
+    unsigned int *slot = findSlot(shard, str.data(), length, hash);
+    if (*slot != 0) {
+        return *slot;
+    }//if
+
+    unsigned int newKey = __sync_fetch_and_add(&nextKey, 1);
+    addToShard(shard, slot, newKey, str.data(), length, hash);
+
+    return newKey;
 }//getStringVal
 
-//Returns the string for a given key in the table
-std::string &StringTable::getString(unsigned int key)
+//Put a string back under the key it had when the table was saved. Restoring every key in
+//turn gives back an identical table, so new strings get the same keys as they would have.
+void StringTable::restoreString(unsigned int key, const std::string &str)
 {
-    std::unordered_map<unsigned int, std::string>::iterator tableIter = table.find(key);
+    if (true == frozen) {
+        throw std::logic_error("StringTable is frozen");
+    }//if
 
-    if (tableIter != table.end()) {
-        return tableIter->second;
+    unsigned int length = str.size();
+    uint64_t hash = hashChars(str.data(), length);
+    Shard &shard = shards[hash >> (64 - numShardBits)];
+
+    boost::mutex::scoped_lock lock(shard.shardLock);
+
+    if (shard.slots.empty() == true) {
+        growSlots(shard);
+    }//if
+
+    unsigned int *slot = findSlot(shard, str.data(), length, hash);
+    if (*slot != 0) {
+        setToken(key, getToken(*slot));
+        *slot = key;
     } else {
-        return table[0]; //""
+        addToShard(shard, slot, key, str.data(), length, hash);
+    }//if
+
+    //Move the key counter past key
+    unsigned int curNextKey = nextKey;
+    while (curNextKey <= key) {
+        unsigned int seenNextKey = __sync_val_compare_and_swap(&nextKey, curNextKey, key + 1);
+        if (seenNextKey == curNextKey) {
+            break;
+        }//if
+
+        curNextKey = seenNextKey;
+    }//while
+}//restoreString
+
+//The key of a string, or 0 if it isn't in the table
+unsigned int StringTable::findStringVal(const std::string &str)
+{
+    unsigned int length = str.size();
+    uint64_t hash = hashChars(str.data(), length);
+
+    if (true == frozen) {
+        if (frozenSlots.empty() == true) {
+            return 0;
+        }//if
+
+        unsigned int key = frozenSlots[frozenSlotFor(hash)];
+        const Token &token = frozenTokens[key];
+        if ((token.length == length) && (memcmp(token.chars, str.data(), length) == 0)) {
+            return key;
+        }//if
+
+        return 0;
+    }//if
+
+    Shard &shard = shards[hash >> (64 - numShardBits)];
+    boost::mutex::scoped_lock lock(shard.shardLock);
+
+    if (shard.slots.empty() == true) {
+        return 0;
+    }//if
+
+    return *findSlot(shard, str.data(), length, hash);
+}//findStringVal
+
+//Where in frozenSlots the key of a string with the given hash is
+size_t StringTable::frozenSlotFor(uint64_t hash) const
+{
+    uint32_t seed = frozenSeeds[(hash >> 32) % frozenSeeds.size()];
+    if ((seed & directSlotFlag) != 0) {
+        return seed & ~directSlotFlag;
+    }//if
+
+    return seededHash(hash, frozenSalt + seed) % frozenSlots.size();
+}//frozenSlotFor
+
+//Build the minimal perfect hash of a frozen table by hash and displace: the strings are put in
+//buckets by hash, and going from the biggest bucket to the smallest, each bucket gets the first seed
+//that sends all its strings to free slots. Buckets of one string come last, when there are few free
+//slots left to hit; they just take the next free slot, which the seed then holds outright.
+//Fails if some bucket can't be placed.
+bool StringTable::buildFrozenSlots(const std::vector<uint64_t> &hashes, const std::vector<unsigned int> &keys)
+{
+    size_t numKeys = keys.size();
+    size_t numBuckets = numKeys / 2 + 1; //Two strings to a bucket on average
+
+    frozenSlots.assign(numKeys, 0);
+    frozenSeeds.assign(numBuckets, 0);
+
+    std::vector<std::vector<unsigned int> > buckets(numBuckets);
+    for (unsigned int keyNum = 0; keyNum < numKeys; ++keyNum) {
+        buckets[(hashes[keyNum] >> 32) % numBuckets].push_back(keyNum);
+    }//for
+
+    std::vector<std::vector<unsigned int> *> bucketOrder;
+    BOOST_FOREACH (std::vector<unsigned int> &bucket, buckets) {
+        bucketOrder.push_back(&bucket);
+    }//foreach
+    std::stable_sort(bucketOrder.begin(), bucketOrder.end(), largerBucket);
+
+    uint32_t maxSeed = 1 << 20;
+
+    std::vector<size_t> slotNums;
+    size_t freeSlotNum = 0;
+    BOOST_FOREACH (std::vector<unsigned int> *bucket, bucketOrder) {
+        if (bucket->empty() == true) {
+            break;
+        }//if
+
+        if (bucket->size() == 1) {
+            while (frozenSlots[freeSlotNum] != 0) {
+                ++freeSlotNum;
+            }//while
+
+            frozenSeeds[(hashes[bucket->front()] >> 32) % numBuckets] = directSlotFlag | freeSlotNum;
+            frozenSlots[freeSlotNum] = keys[bucket->front()];
+            continue;
+        }//if
+
+        uint32_t seed = 0;
+        for (; seed < maxSeed; ++seed) {
+            slotNums.clear();
+            BOOST_FOREACH (unsigned int keyNum, *bucket) {
+                size_t slotNum = seededHash(hashes[keyNum], frozenSalt + seed) % numKeys;
+                if ((frozenSlots[slotNum] != 0) || (std::find(slotNums.begin(), slotNums.end(), slotNum) != slotNums.end())) {
+                    break;
+                }//if
+
+                slotNums.push_back(slotNum);
+            }//foreach
+
+            if (slotNums.size() == bucket->size()) {
+                break;
+            }//if
+        }//for
+
+        if (seed == maxSeed) {
+            return false;
+        }//if
+
+        frozenSeeds[(hashes[bucket->front()] >> 32) % numBuckets] = seed;
+        for (unsigned int member = 0; member < bucket->size(); ++member) {
+            frozenSlots[slotNums[member]] = keys[(*bucket)[member]];
+        }//for
+    }//foreach
+
+    return true;
+}//buildFrozenSlots
+
+//Pack the table once nothing more is going to be added
+void StringTable::freeze()
+{
+    if (true == frozen) {
+        return;
     }//if
-}//getString
 
+    //Characters into one buffer, tokens into a flat array
+    size_t numChars = 0;
+    for (unsigned int key = 0; key < nextKey; ++key) {
+        numChars += getToken(key).length;
+    }//for
+
+    frozenChars.resize(numChars);
+    frozenTokens.assign(nextKey, emptyToken);
+
+    std::vector<uint64_t> hashes;
+    std::vector<unsigned int> keys;
+    size_t charPos = 0;
+    for (unsigned int key = 0; key < nextKey; ++key) {
+        const Token &token = getToken(key);
+        if (0 == token.length) {
+            continue;
+        }//if
+
+        memcpy(&frozenChars[charPos], token.chars, token.length);
+        frozenTokens[key] = token;
+        frozenTokens[key].chars = &frozenChars[charPos];
+        charPos += token.length;
+
+        hashes.push_back(hashChars(token.chars, token.length));
+        keys.push_back(key);
+    }//for
+
+    //A different salt gives every bucket a fresh set of seeds to try
+    for (unsigned int attempt = 0; buildFrozenSlots(hashes, keys) == false; ++attempt) {
+        frozenSalt = (attempt + 1) * 0x9e3779b97f4a7c15ULL;
+    }//for
+
+    //Done with the shards
+    for (unsigned int shardNum = 0; shardNum < numShards; ++shardNum) {
+        Shard &shard = shards[shardNum];
+
+        std::vector<unsigned int>().swap(shard.slots);
+        BOOST_FOREACH (char *arenaPage, shard.arenaPages) {
+            delete [] arenaPage;
+        }//foreach
+        std::vector<char *>().swap(shard.arenaPages);
+        shard.arenaPos = NULL;
+        shard.arenaLeft = 0;
+    }//for
+
+    BOOST_FOREACH (Token *page, pages) {
+        delete [] page;
+    }//foreach
+    std::vector<Token *>().swap(pages);
 
+    frozen = true;
+}//freeze
 
@@ -9,22 +9,140 @@ License: Released under the GPL version 3 license. See the included LICENSE.
 #ifndef __STRINGTABLE_H
 #define __STRINGTABLE_H
 
-#include <unordered_map>
 #include <string>
+#include <vector>
+#include <tr1/memory>
+#include <stdint.h>
+#include <boost/thread/mutex.hpp>
 
-//A simple string table
+//A normalized string (its words as string table keys, in order) which several records can share
+typedef std::tr1::shared_ptr<const std::vector<unsigned int> > SharedTokens;
+
+//A string table which many threads can add strings to at once. Strings are spread over shards by
+//hash, each with its own lock, so threads only wait on each other when they hit the same shard.
+//Keys come from one counter shared by the shards: they start at 2 (0 being the empty string), have
+//no gaps, and never change once handed out. Which string gets which key depends on the order the
+//threads get to them in.
+//
+//Every key has a Token: where the string's characters are, its length and its hash. Tokens sit in
+//pages indexed by key, and the characters in each shard's arena, so looking a key up is a couple of
+//indexed loads. Neither the pages nor the arenas ever move, and looking up doesn't lock. It's safe
+//for keys the calling thread got from the table itself, and for any key once nothing is being added
+//anymore.
+//
+//Once everything has been added, freeze() packs the table: the characters into one buffer, the
+//tokens into a flat array indexed by key, and the string -> key side into a minimal perfect hash.
+//The shards are then thrown away. A frozen table is read only and any number of threads can share it.
 class StringTable
 {
-    std::unordered_map<unsigned int, std::string> table;
-    std::unordered_map<std::string, unsigned int> tableRev;
+public:
+    struct Token
+    {
+        const char *chars; //Not null terminated
+        unsigned int length;
+        unsigned int hash;
+    };//Token
+
+private:
+    static const unsigned int numShardBits = 6;
+    static const unsigned int numShards = 1 << numShardBits;
+
+    static const unsigned int pageBits = 12;
+    static const unsigned int pageSize = 1 << pageBits;
+    static const unsigned int maxPages = 1 << 16;
+
+    static const size_t arenaPageSize = 64 * 1024;
+
+    //Set in a frozen bucket's seed when the seed is its string's slot number itself
+    static const uint32_t directSlotFlag = 0x80000000u;
+
+    //The keys of a shard's strings in an open addressed hash table (0 marks an empty slot),
+    //and the arena their characters are kept in. Each shard starts on its own cache line, so
+    //threads locking neighbouring shards don't fight over one line.
+    struct __attribute__((aligned(64))) Shard
+    {
+        boost::mutex shardLock;
+        std::vector<unsigned int> slots;
+        unsigned int numKeys;
+
+        std::vector<char *> arenaPages;
+        char *arenaPos;
+        size_t arenaLeft;
+
+        Shard() : numKeys(0), arenaPos(NULL), arenaLeft(0) {}
+    };//Shard
+
+    Shard shards[numShards];
+
+    std::vector<Token *> pages;
+    boost::mutex pageLock; //Only taken to add a page
+
+    unsigned int nextKey;
+    Token emptyToken;
+
+    //The table once it's frozen. A string's key is in frozenSlots, at a position picked by its hash and
+    //the seed of the bucket its hash falls in (see freeze).
+    bool frozen;
+    std::vector<char> frozenChars;
+    std::vector<Token> frozenTokens;
+    std::vector<unsigned int> frozenSlots;
+    std::vector<uint32_t> frozenSeeds;
+    uint64_t frozenSalt;
+
+    StringTable(const StringTable &);
+    StringTable &operator=(const StringTable &);
+
+    unsigned int *findSlot(Shard &shard, const char *chars, unsigned int length, uint64_t hash);
+    void addToShard(Shard &shard, unsigned int *slot, unsigned int key, const char *chars, unsigned int length, uint64_t hash);
+    void growSlots(Shard &shard);
+    void setToken(unsigned int key, const Token &token);
+    size_t frozenSlotFor(uint64_t hash) const;
+    bool buildFrozenSlots(const std::vector<uint64_t> &hashes, const std::vector<unsigned int> &keys);
 
 public:
     StringTable();
+    ~StringTable();
 
+    //Not allowed on a frozen table for strings it doesn't already have
     unsigned int getStringVal(const std::string &str);
-    std::string &getString(unsigned int key);
-};//StringTable
 
-#endif
+    //The key of a string, or 0 if it isn't in the table. Never adds anything.
+    unsigned int findStringVal(const std::string &str);
+
+    const Token &getToken(unsigned int key) const
+    {
+        if (true == frozen) {
+            return (key < frozenTokens.size()) ? frozenTokens[key] : emptyToken;
+        }//if
+
+        unsigned int pageNum = key >> pageBits;
+        if (pageNum >= maxPages) {
+            return emptyToken;
+        }//if
+
+        const Token *page = __atomic_load_n(&pages[pageNum], __ATOMIC_ACQUIRE);
+        if ((NULL == page) || (NULL == page[key & (pageSize - 1)].chars)) {
+            return emptyToken;
+        }//if
 
+        return page[key & (pageSize - 1)];
+    }//getToken
 
+    std::string getString(unsigned int key) const
+    {
+        const Token &token = getToken(key);
+        return std::string(token.chars, token.length);
+    }//getString
+
+    //Largest key handed out so far. Keys start at 2, 0 being the empty string.
+    unsigned int getMaxStringVal() const { return nextKey - 1; }
+
+    //Put a string back under the key it had when the table was saved
+    void restoreString(unsigned int key, const std::string &str);
+
+    //Pack the table once nothing more is going to be added. Nothing else may use the table meanwhile.
+    void freeze();
+    bool isFrozen() const { return frozen; }
+};//StringTable
+
+#endif